@@ -0,0 +1,406 @@
+#include "../Interpreter/Number.h"
+#include "../Interpreter/LimbAllocator.h"
+#include "../Interpreter/LimbKernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Microbenchmarks for Number. Every operation is timed on operands of a given
+/// number of 32-bit limbs (division and remainder divide a 2n limb number by an
+/// n limb one) and one CSV row is printed per operation and size:
+///
+///     operation,limbs,iterations,ns_per_op,heap_allocs_per_op,pool_hits_per_op
+///
+/// heap_allocs_per_op counts every call of the global operator new, pool_hits_per_op
+/// counts limb blocks served from the free lists of LimbAllocator.
+///
+/// --limbs N measures the given sizes only. --kernels NAME forces a limb kernel set,
+/// --check-kernels cross-checks every supported set against the scalar kernels and
+/// --check-multiply the multiplication tiers against schoolbook, instead of measuring.
+
+static std::atomic<size_t> heapAllocations(0);
+
+void* operator new(size_t size)
+{
+	heapAllocations++;
+	void* block = std::malloc(size ? size : 1);
+	if (!block) throw std::bad_alloc();
+	return block;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* block) noexcept
+{
+	std::free(block);
+}
+
+void operator delete[](void* block) noexcept
+{
+	std::free(block);
+}
+
+void operator delete(void* block, size_t) noexcept
+{
+	std::free(block);
+}
+
+void operator delete[](void* block, size_t) noexcept
+{
+	std::free(block);
+}
+
+static unsigned long long int randomState = 88172645463325252ULL;
+
+static unsigned int randomLimb()
+{
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 7;
+	randomState ^= randomState << 17;
+	return (unsigned int)(randomState >> 32);
+}
+
+/// Pattern 0 is random, 1 all ones and 2 all zeros (long carry and borrow chains), 3 mostly ones.
+static void fillLimbs(unsigned int* limbs, size_t size, int pattern)
+{
+	for (size_t i = 0; i < size; i++)
+	{
+		if (pattern == 0) limbs[i] = randomLimb();
+		else if (pattern == 1) limbs[i] = 0xFFFFFFFFu;
+		else if (pattern == 2) limbs[i] = 0;
+		else limbs[i] = (randomLimb() % 8) ? 0xFFFFFFFFu : randomLimb();
+	}
+}
+
+/// A number of exactly limbs random limbs
+static Number randomNumber(size_t limbs)
+{
+	std::vector<unsigned int> parts(limbs);
+	fillLimbs(parts.data(), limbs, 0);
+	if (parts[limbs - 1] == 0) parts[limbs - 1] = 1;
+	return Number::fromParts(parts.data(), limbs);
+}
+
+static volatile size_t sink = 0;
+
+static void runAdd(const Number& first, const Number& second, const std::string&) { sink += (first + second).isZero(); }
+static void runSubtract(const Number& first, const Number& second, const std::string&) { sink += (first - second).isZero(); }
+static void runMultiply(const Number& first, const Number& second, const std::string&) { sink += (first * second).isZero(); }
+static void runSquare(const Number& first, const Number&, const std::string&) { sink += (first * first).isZero(); }
+static void runDivide(const Number& first, const Number& second, const std::string&) { sink += (first / second).isZero(); }
+static void runModulo(const Number& first, const Number& second, const std::string&) { sink += (first % second).isZero(); }
+static void runLess(const Number& first, const Number& second, const std::string&) { sink += (first < second); }
+static void runEqual(const Number& first, const Number& second, const std::string&) { sink += (first == second); }
+static void runParse(const Number&, const Number&, const std::string& digits) { sink += Number(digits).isZero(); }
+static void runPrint(const Number& first, const Number&, const std::string&) { sink += first.toString().size(); }
+
+enum OperandShape
+{
+	independentOperands,
+	/// the larger of the two is first, so that the difference does not saturate to 0
+	largerFirstOperand,
+	/// first has twice as many limbs as second
+	doubleFirstOperand,
+	/// second is a copy of first, so comparisons scan every limb
+	equalOperands
+};
+
+struct Operation
+{
+	const char* name;
+	void (*run)(const Number&, const Number&, const std::string&);
+	OperandShape shape;
+	/// Largest operand size (in limbs) measured by default, to keep the slower operations bounded.
+	size_t maxLimbs;
+};
+
+static const Operation operations[] =
+{
+	{ "add", runAdd, independentOperands, 1048576 },
+	{ "subtract", runSubtract, largerFirstOperand, 1048576 },
+	{ "multiply", runMultiply, independentOperands, 1048576 },
+	{ "square", runSquare, independentOperands, 1048576 },
+	{ "divide", runDivide, doubleFirstOperand, 262144 },
+	{ "modulo", runModulo, doubleFirstOperand, 262144 },
+	{ "less", runLess, equalOperands, 1048576 },
+	{ "equal", runEqual, equalOperands, 1048576 },
+	{ "parse", runParse, independentOperands, 262144 },
+	{ "print", runPrint, independentOperands, 262144 }
+};
+
+static void measure(const Operation& operation, size_t limbs, double minSeconds)
+{
+	Number first = randomNumber(operation.shape == doubleFirstOperand ? 2 * limbs : limbs), second = randomNumber(limbs);
+
+	if (operation.shape == largerFirstOperand && first < second) std::swap(first, second);
+	if (operation.shape == equalOperands) second = first;
+	std::string firstDigits = (operation.run == runParse ? first.toString() : std::string());
+
+	size_t iterations = 1, total = 0, allocations = 0, poolHits = 0;
+	double elapsed = 0;
+
+	operation.run(first, second, firstDigits);
+	while (elapsed < minSeconds)
+	{
+		size_t heapBefore = heapAllocations;
+		LimbAllocator::resetStatistics();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for (size_t i = 0; i < iterations; i++) operation.run(first, second, firstDigits);
+
+		elapsed += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		allocations += heapAllocations - heapBefore;
+		poolHits += LimbAllocator::statistics().hits;
+		total += iterations;
+		iterations *= 2;
+	}
+
+	std::printf("%s,%zu,%zu,%.1f,%.2f,%.2f\n", operation.name, limbs, total, elapsed * 1e9 / total, (double)allocations / total, (double)poolHits / total);
+	std::fflush(stdout);
+}
+
+/// Runs every vector kernel set the CPU supports against the scalar kernels on
+/// all lengths up to 80 limbs at every alignment mod 4, returns the number of mismatches.
+static size_t checkKernels()
+{
+	LimbKernels::useScalarKernels();
+	LimbKernels::CarryKernel addScalar = LimbKernels::add, subtractScalar = LimbKernels::subtract;
+	LimbKernels::CompareKernel compareScalar = LimbKernels::compare;
+	LimbKernels::EqualKernel equalScalar = LimbKernels::equal;
+
+	static const char* const sets[] = { "sse4.2", "avx2" };
+	std::vector<unsigned int> first(84), second(84), expected(84), actual(84);
+	size_t mismatches = 0;
+
+	for (size_t set = 0; set < sizeof(sets) / sizeof(sets[0]); set++)
+	{
+		if (!LimbKernels::useKernels(sets[set]))
+		{
+			std::fprintf(stderr, "%s: not supported, skipped\n", sets[set]);
+			continue;
+		}
+
+		size_t checks = 0, failed = 0;
+		for (size_t size = 0; size <= 80; size++)
+		{
+			for (size_t offset = 0; offset < 4; offset++)
+			{
+				for (int pattern = 0; pattern < 16; pattern++)
+				{
+					std::fill(first.begin(), first.end(), 0);
+					std::fill(expected.begin(), expected.end(), 0);
+					std::fill(actual.begin(), actual.end(), 0);
+					unsigned int* a = first.data() + offset;
+					unsigned int* b = second.data() + offset;
+					fillLimbs(a, size, pattern / 4);
+					fillLimbs(b, size, pattern % 4);
+
+					unsigned int expectedCarry = addScalar(expected.data() + offset, a, b, size);
+					unsigned int actualCarry = LimbKernels::add(actual.data() + offset, a, b, size);
+					failed += (expectedCarry != actualCarry || expected != actual);
+
+					expectedCarry = subtractScalar(expected.data() + offset, a, b, size);
+					actualCarry = LimbKernels::subtract(actual.data() + offset, a, b, size);
+					failed += (expectedCarry != actualCarry || expected != actual);
+
+					/// In place, as Number uses them
+					actual = first;
+					actualCarry = LimbKernels::add(actual.data() + offset, actual.data() + offset, b, size);
+					expectedCarry = addScalar(expected.data() + offset, a, b, size);
+					failed += (expectedCarry != actualCarry || expected != actual);
+
+					failed += (compareScalar(a, b, size) != LimbKernels::compare(a, b, size));
+					failed += (equalScalar(a, b, size) != LimbKernels::equal(a, b, size));
+
+					/// Equal operands that differ in one limb, so the scan stops at every position
+					std::copy(a, a + size, b);
+					failed += (LimbKernels::compare(a, b, size) != 0 || !LimbKernels::equal(a, b, size));
+					if (size)
+					{
+						b[randomLimb() % size] ^= 1u << (randomLimb() % 32);
+						failed += (compareScalar(a, b, size) != LimbKernels::compare(a, b, size));
+						failed += (equalScalar(a, b, size) != LimbKernels::equal(a, b, size));
+					}
+					checks += size ? 9 : 7;
+				}
+			}
+		}
+
+		std::fprintf(stderr, "%s: %zu checks, %zu mismatches\n", sets[set], checks, failed);
+		mismatches += failed;
+	}
+
+	LimbKernels::selectKernels();
+	return mismatches;
+}
+
+/// The schoolbook product of the original Number, over 32-bit limbs
+static void referenceMultiply(const unsigned int* first, size_t firstSize, const unsigned int* second, size_t secondSize, unsigned int* result)
+{
+	std::fill(result, result + firstSize + secondSize, 0);
+	for (size_t i = 0; i < firstSize; i++)
+	{
+		unsigned long long int carry = 0;
+		for (size_t j = 0; j < secondSize; j++)
+		{
+			unsigned long long int current = (unsigned long long int)first[i] * second[j] + result[i + j] + carry;
+			result[i + j] = (unsigned int)current;
+			carry = current >> 32;
+		}
+		result[i + secondSize] = (unsigned int)carry;
+	}
+}
+
+/// Compares the products of Number with referenceMultiply on both sides of every
+/// threshold of the multiplication, then checks division around the Burnikel-Ziegler
+/// threshold with the products just checked; returns the number of mismatches.
+static size_t checkMultiply()
+{
+	/// Karatsuba, Karatsuba squaring, Toom-3 and Toom-3 squaring
+	static const size_t thresholds[] = { 32, 48, 2000, 3000 };
+	/// Operand sizes relative to the second one: balanced, just longer, the Toom-3 shape limit, chunked
+	static const double shapes[] = { 1.0, 1.05, 1.5, 2.0, 3.3 };
+	size_t mismatches = 0, checks = 0;
+
+	for (size_t t = 0; t < sizeof(thresholds) / sizeof(thresholds[0]); t++)
+	{
+		for (size_t secondSize = thresholds[t] - 1; secondSize <= thresholds[t] + 1; secondSize++)
+		{
+			for (size_t shape = 0; shape < sizeof(shapes) / sizeof(shapes[0]); shape++)
+			{
+				size_t firstSize = (size_t)(secondSize * shapes[shape]) + (shape == 0 ? 0 : 1);
+				std::vector<unsigned int> first(firstSize), second(secondSize), expected(firstSize + secondSize);
+
+				/// Random limbs, then all ones for the longest carry chains
+				for (int pattern = 0; pattern < 2; pattern++)
+				{
+					fillLimbs(first.data(), firstSize, pattern);
+					fillLimbs(second.data(), secondSize, pattern);
+					first[firstSize - 1] |= 1;
+					second[secondSize - 1] |= 1;
+					Number firstNumber = Number::fromParts(first.data(), firstSize), secondNumber = Number::fromParts(second.data(), secondSize);
+
+					referenceMultiply(first.data(), firstSize, second.data(), secondSize, expected.data());
+					bool matches = (firstNumber * secondNumber == Number::fromParts(expected.data(), expected.size()));
+					checks++;
+
+					if (shape == 0)
+					{
+						/// The same number twice takes the squaring path
+						referenceMultiply(first.data(), firstSize, first.data(), firstSize, expected.data());
+						matches &= (firstNumber * firstNumber == Number::fromParts(expected.data(), expected.size()));
+						checks++;
+					}
+					if (!matches)
+					{
+						std::fprintf(stderr, "multiply %zu x %zu (pattern %d): mismatch\n", firstSize, secondSize, pattern);
+						mismatches++;
+					}
+				}
+			}
+		}
+	}
+
+	/// Burnikel-Ziegler needs a divider and a quotient of at least 32 limbs
+	static const size_t dividers[] = { 31, 32, 33, 63, 64, 65, 1000 };
+	static const size_t quotients[] = { 1, 31, 32, 33, 250 };
+	for (size_t d = 0; d < sizeof(dividers) / sizeof(dividers[0]); d++)
+	{
+		for (size_t q = 0; q < sizeof(quotients) / sizeof(quotients[0]); q++)
+		{
+			Number dividend = randomNumber(dividers[d] + quotients[q]), divider = randomNumber(dividers[d]), quotient, remainder;
+			dividend.divmod(divider, quotient, remainder);
+			checks++;
+
+			if (!(remainder < divider) || quotient * divider + remainder != dividend)
+			{
+				std::fprintf(stderr, "divide %zu by %zu limbs: mismatch\n", dividers[d] + quotients[q], dividers[d]);
+				mismatches++;
+			}
+		}
+	}
+
+	std::fprintf(stderr, "multiply and divide: %zu checks, %zu mismatches\n", checks, mismatches);
+	return mismatches;
+}
+
+static void printUsage(const char* program)
+{
+	std::fprintf(stderr, "usage: %s [--operation NAME]... [--max-limbs N] [--min-time SECONDS] [--scalar | --kernels NAME] [--limbs N]... [--check-kernels] [--check-multiply] [--threads N] [--parallel-threshold LIMBS]\n", program);
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> selected;
+	std::vector<size_t> sizes;
+	size_t maxLimbs = 0, parallelThreshold = 20000;
+	bool checkingKernels = false, checkingMultiply = false;
+	unsigned int threads = std::thread::hardware_concurrency();
+	double minSeconds = 0.2;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+
+		if (argument == "--operation" && i + 1 < argc) selected.push_back(argv[++i]);
+		else if (argument == "--limbs" && i + 1 < argc) sizes.push_back(std::strtoull(argv[++i], nullptr, 10));
+		else if (argument == "--max-limbs" && i + 1 < argc) maxLimbs = std::strtoull(argv[++i], nullptr, 10);
+		else if (argument == "--min-time" && i + 1 < argc) minSeconds = std::atof(argv[++i]);
+		else if (argument == "--scalar") LimbKernels::useScalarKernels();
+		else if (argument == "--kernels" && i + 1 < argc)
+		{
+			if (!LimbKernels::useKernels(argv[++i]))
+			{
+				std::fprintf(stderr, "limb kernels %s are not supported\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (argument == "--check-kernels") checkingKernels = true;
+		else if (argument == "--check-multiply") checkingMultiply = true;
+		else if (argument == "--threads" && i + 1 < argc) threads = std::atoi(argv[++i]);
+		else if (argument == "--parallel-threshold" && i + 1 < argc) parallelThreshold = std::strtoull(argv[++i], nullptr, 10);
+		else
+		{
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	Number::setParallelMultiplication(parallelThreshold, threads);
+
+	if (checkingKernels || checkingMultiply)
+	{
+		size_t mismatches = (checkingKernels ? checkKernels() : 0);
+		mismatches += (checkingMultiply ? checkMultiply() : 0);
+		return mismatches ? 1 : 0;
+	}
+
+	std::fprintf(stderr, "limb kernels: %s, threads: %u\n", LimbKernels::instructionSet(), threads ? threads : 1);
+	std::printf("operation,limbs,iterations,ns_per_op,heap_allocs_per_op,pool_hits_per_op\n");
+
+	for (size_t i = 0; i < sizeof(operations) / sizeof(operations[0]); i++)
+	{
+		bool wanted = selected.empty();
+		for (size_t j = 0; j < selected.size(); j++) wanted |= (selected[j] == operations[i].name);
+		if (!wanted) continue;
+
+		for (size_t j = 0; j < sizes.size(); j++) measure(operations[i], sizes[j], minSeconds);
+		for (size_t limbs = 1; limbs <= 1048576 && sizes.empty(); limbs *= 4)
+		{
+			if (limbs > (maxLimbs ? maxLimbs : operations[i].maxLimbs)) break;
+			measure(operations[i], limbs, minSeconds);
+		}
+	}
+
+	return 0;
+}
\ No newline at end of file
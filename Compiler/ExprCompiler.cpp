@@ -0,0 +1,47 @@
+#include "../Interpreter/Interpreter.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+/// Translates an EXPR program to C++. Build the result with "make native PROGRAM=...".
+int main(int argc, char** argv)
+{
+	Interpreter IT;
+	string programAddress;
+	string sourceAddress;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!string("--no-optimize").compare(argv[i])) IT.setOptimization(false);
+		else if (!string("--no-memo").compare(argv[i])) IT.setMemoization(false);
+		else if (programAddress.empty()) programAddress = argv[i];
+		else sourceAddress = argv[i];
+	}
+
+	if (programAddress.empty() || sourceAddress.empty())
+	{
+		cerr << "usage: exprc [--no-optimize] [--no-memo] program.EXPR output.cpp\n";
+		return 1;
+	}
+
+	ofstream source(sourceAddress);
+	if (!source)
+	{
+		cerr << "Cannot write " << sourceAddress << '\n';
+		return 1;
+	}
+
+	ostringstream errors;
+	IT.translate(programAddress, source, errors);
+	if (!errors.str().empty())
+	{
+		cerr << errors.str();
+		return 1;
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+#include "Number.h"
+
+enum Opcode : unsigned char
+{
+	/// Value stack
+	pushConstantOpcode,						/// operand: constant index
+	loadVariableOpcode,						/// operand: slot
+	storeVariableOpcode,					/// operand: slot
+	readVariableOpcode,						/// operand: slot
+	printOpcode,
+
+	/// Arithmetic, both operands are popped and the result is pushed
+	addOpcode,
+	subtractOpcode,
+	multiplyOpcode,
+	divideOpcode,
+	moduloOpcode,
+	divideModuloOpcode,						/// pushes the quotient and then the remainder
+
+	/// Conditions, the result is pushed as 0 or 1
+	lessOpcode,
+	greaterOpcode,
+	equalOpcode,
+	notOpcode,
+
+	/// Control flow, operand: target index in the same code
+	jumpOpcode,
+	jumpIfFalseOpcode,
+	jumpIfTrueOpcode,
+
+	/// Functions
+	defineFunctionOpcode,					/// operand: function index
+	checkFunctionOpcode,					/// operand: slot
+	callOpcode,								/// operand: slot
+	tailCallOpcode,							/// operand: slot, runs the function in the current frame
+	returnOpcode,
+	endOpcode,
+
+	/// Loops
+	enterLoopOpcode,						/// operand: loop index, invalidates its invariant caches
+	loadInvariantOpcode,					/// operand: cache entry, pushes a valid value and skips the next instruction
+	storeInvariantOpcode,					/// operand: cache entry, the value stays on the stack
+	checkVariableOpcode,					/// operand: slot
+	lessCounterOpcode,						/// operand: slot of the counter, compared with the popped bound
+	stepCounterOpcode,						/// operand: slot of the counter, the popped step is added in place
+
+	/// Inlined calls
+	storeArgumentOpcode,					/// operand: call site, pops the argument
+	loadArgumentOpcode						/// operand: call site
+};
+
+struct BytecodeInstruction
+{
+	Opcode opcode;
+	int operand;
+};
+
+struct BytecodeFunction
+{
+	/// Slots of the function name and of its parameter, -1 for the main code
+	int name;
+	int parameter;
+	/// Memo table of a pure recdef, -1 otherwise
+	int memoTable;
+	std::vector<BytecodeInstruction> code;
+};
+
+struct BytecodeProgram
+{
+	/// functions[0] is the main code
+	std::vector<BytecodeFunction> functions;
+	std::vector<Number> constants;
+	/// Identifier of every slot
+	std::vector<std::string> names;
+};
\ No newline at end of file
@@ -0,0 +1,286 @@
+#include "BytecodeCompiler.h"
+
+/// Constants 0 and 1 are always present, conditions push them directly.
+static const int falseConstant = 0;
+static const int trueConstant = 1;
+
+BytecodeCompiler::BytecodeCompiler()
+{
+	program.constants.push_back(Number(0));
+	program.constants.push_back(Number(1));
+
+	BytecodeFunction main;
+	main.name = -1;
+	main.parameter = -1;
+	main.memoTable = -1;
+	program.functions.push_back(main);
+}
+
+int BytecodeCompiler::constant(const Number& value)
+{
+	program.constants.push_back(value);
+	return program.constants.size() - 1;
+}
+
+int BytecodeCompiler::emit(int function, Opcode opcode, int operand)
+{
+	BytecodeInstruction instruction;
+	instruction.opcode = opcode;
+	instruction.operand = operand;
+
+	std::vector<BytecodeInstruction>& code = program.functions[function].code;
+	code.push_back(instruction);
+	return code.size() - 1;
+}
+
+void BytecodeCompiler::patchJump(int function, int jump)
+{
+	std::vector<BytecodeInstruction>& code = program.functions[function].code;
+	code[jump].operand = code.size();
+}
+
+void BytecodeCompiler::compileSequence(const Instruction& sequence, int function)
+{
+	for (size_t i = 0; i < sequence.parameters.size(); i++)
+	{
+		if (i + 1 < sequence.parameters.size() && sequence.parameters[i].pairsDivision(sequence.parameters[i + 1]))
+		{
+			compileDivisionPair(sequence.parameters[i], sequence.parameters[i + 1], function);
+			i++;
+		}
+		else compileStatement(sequence.parameters[i], function);
+	}
+}
+
+void BytecodeCompiler::compileDivisionPair(const Instruction& first, const Instruction& second, int function)
+{
+	const Instruction& division = first.parameters[1];
+	compileValue(division.parameters[0], function);
+	compileValue(division.parameters[1], function);
+	emit(function, divideModuloOpcode);
+
+	/// The remainder is on top of the quotient
+	bool quotientFirst = (division.operation == '/');
+	emit(function, storeVariableOpcode, (quotientFirst ? second : first).parameters[0].slot);
+	emit(function, storeVariableOpcode, (quotientFirst ? first : second).parameters[0].slot);
+}
+
+void BytecodeCompiler::compileStatement(const Instruction& ins, int function)
+{
+	switch (ins.type)
+	{
+	case Instruction::sequenceType:
+		compileSequence(ins, function);
+		break;
+	case Instruction::ifStatementType:
+	{
+		compileValue(ins.parameters[0], function);
+		int elseJump = emit(function, jumpIfFalseOpcode);
+		compileSequence(ins.parameters[1], function);
+		int endJump = emit(function, jumpOpcode);
+		patchJump(function, elseJump);
+		compileSequence(ins.parameters[2], function);
+		patchJump(function, endJump);
+		break;
+	}
+	case Instruction::whileStatementType:
+	case Instruction::countedWhileType:
+	{
+		if (ins.loop >= 0) emit(function, enterLoopOpcode, ins.loop);
+
+		int start = program.functions[function].code.size();
+		const Instruction& cond = ins.parameters[0];
+		if (ins.type == Instruction::countedWhileType)
+		{
+			int counter = cond.parameters[0].slot;
+			emit(function, checkVariableOpcode, counter);
+			compileValue(cond.parameters[1], function);
+			emit(function, lessCounterOpcode, counter);
+		}
+		else compileValue(cond, function);
+		int endJump = emit(function, jumpIfFalseOpcode);
+		compileSequence(ins.parameters[1], function);
+		emit(function, jumpOpcode, start);
+		patchJump(function, endJump);
+		break;
+	}
+	case Instruction::counterStepType:
+		compileValue(ins.parameters[1], function);
+		emit(function, stepCounterOpcode, ins.parameters[0].slot);
+		break;
+	case Instruction::readType:
+		emit(function, readVariableOpcode, ins.parameters[0].slot);
+		break;
+	case Instruction::printType:
+		compileValue(ins.parameters[0], function);
+		emit(function, printOpcode);
+		break;
+	case Instruction::returnType:
+	{
+		const Instruction& value = ins.parameters[0];
+		if (value.type == Instruction::tailCallType)
+		{
+			emit(function, checkFunctionOpcode, value.parameters[0].slot);
+			compileValue(value.parameters[1], function);
+			emit(function, tailCallOpcode, value.parameters[0].slot);
+			break;
+		}
+		compileValue(value, function);
+		emit(function, returnOpcode);
+		break;
+	}
+	case Instruction::variableDefinitionType:
+		compileValue(ins.parameters[1], function);
+		emit(function, storeVariableOpcode, ins.parameters[0].slot);
+		break;
+	case Instruction::functionDefinitionType:
+	case Instruction::recursiveFunctionDefinitionType:
+		emit(function, defineFunctionOpcode, compileFunction(ins));
+		break;
+	default:
+		break;
+	}
+}
+
+void BytecodeCompiler::compileValue(const Instruction& ins, int function)
+{
+	switch (ins.type)
+	{
+	case Instruction::booleanType:
+	{
+		if (ins.operation == '!')
+		{
+			compileValue(ins.parameters[0], function);
+			emit(function, notOpcode);
+		}
+		else if (ins.operation == '&' || ins.operation == '|')
+		{
+			/// The second condition is evaluated only when the first one does not decide the result
+			bool isAnd = (ins.operation == '&');
+			compileValue(ins.parameters[0], function);
+			int shortCircuit = emit(function, isAnd ? jumpIfFalseOpcode : jumpIfTrueOpcode);
+			compileValue(ins.parameters[1], function);
+			int endJump = emit(function, jumpOpcode);
+			patchJump(function, shortCircuit);
+			emit(function, pushConstantOpcode, isAnd ? falseConstant : trueConstant);
+			patchJump(function, endJump);
+		}
+		else
+		{
+			compileValue(ins.parameters[0], function);
+			compileValue(ins.parameters[1], function);
+			switch (ins.operation)
+			{
+			case '<':
+				emit(function, lessOpcode);
+				break;
+			case '>':
+				emit(function, greaterOpcode);
+				break;
+			case '=':
+				emit(function, equalOpcode);
+				break;
+			}
+		}
+		break;
+	}
+	case Instruction::arithmeticType:
+	{
+		compileValue(ins.parameters[0], function);
+		compileValue(ins.parameters[1], function);
+		switch (ins.operation)
+		{
+		case '+':
+			emit(function, addOpcode);
+			break;
+		case '-':
+			emit(function, subtractOpcode);
+			break;
+		case '*':
+			emit(function, multiplyOpcode);
+			break;
+		case '/':
+			emit(function, divideOpcode);
+			break;
+		case '%':
+			emit(function, moduloOpcode);
+			break;
+		}
+		break;
+	}
+	case Instruction::basicBooleanType:
+		emit(function, pushConstantOpcode, ins.booleanValue ? trueConstant : falseConstant);
+		break;
+	case Instruction::numberType:
+		emit(function, pushConstantOpcode, constant(ins.number));
+		break;
+	case Instruction::variableNameType:
+		emit(function, loadVariableOpcode, ins.slot);
+		break;
+	case Instruction::invariantType:
+	{
+		/// A valid cached value skips the jump over the computation
+		emit(function, loadInvariantOpcode, ins.cacheEntry);
+		int endJump = emit(function, jumpOpcode);
+		compileValue(ins.parameters[0], function);
+		emit(function, storeInvariantOpcode, ins.cacheEntry);
+		patchJump(function, endJump);
+		break;
+	}
+	case Instruction::inlineCallType:
+		compileValue(ins.parameters[0], function);
+		emit(function, storeArgumentOpcode, ins.argument);
+		compileValue(ins.parameters[1], function);
+		break;
+	case Instruction::inlineArgumentType:
+		emit(function, loadArgumentOpcode, ins.argument);
+		break;
+	case Instruction::functionCallType:
+	{
+		/// The function has to be defined before its argument is evaluated
+		int name = ins.parameters[0].slot;
+		emit(function, checkFunctionOpcode, name);
+		compileValue(ins.parameters[1], function);
+		emit(function, callOpcode, name);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+int BytecodeCompiler::compileFunction(const Instruction& definition)
+{
+	BytecodeFunction compiled;
+	compiled.name = definition.parameters[0].slot;
+	compiled.parameter = definition.parameters[1].slot;
+	compiled.memoTable = -1;
+	if (definition.type == Instruction::recursiveFunctionDefinitionType) compiled.memoTable = definition.memoTable;
+
+	int function = program.functions.size();
+	program.functions.push_back(compiled);
+
+	if (definition.type == Instruction::functionDefinitionType)
+	{
+		compileValue(definition.parameters[2], function);
+		emit(function, returnOpcode);
+	}
+	else
+	{
+		compileSequence(definition.parameters[2], function);
+		emit(function, endOpcode);
+	}
+
+	return function;
+}
+
+BytecodeProgram BytecodeCompiler::compile(const Instruction& mainSequence, const std::vector<std::string>& slotNames)
+{
+	BytecodeCompiler compiler;
+	compiler.program.names = slotNames;
+
+	compiler.compileSequence(mainSequence, 0);
+	compiler.emit(0, endOpcode);
+
+	return compiler.program;
+}
\ No newline at end of file
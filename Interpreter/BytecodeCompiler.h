@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Bytecode.h"
+#include "Instruction.h"
+
+/// Translates a parsed program into the linear code run by VirtualMachine.
+class BytecodeCompiler
+{
+private:
+	BytecodeProgram program;
+
+	BytecodeCompiler();
+
+	int constant(const Number&);
+	int emit(int function, Opcode, int operand = 0);
+	void patchJump(int function, int jump);
+
+	void compileSequence(const Instruction&, int function);
+	void compileDivisionPair(const Instruction& first, const Instruction& second, int function);
+	void compileStatement(const Instruction&, int function);
+	void compileValue(const Instruction&, int function);
+	int compileFunction(const Instruction&);
+
+public:
+	/// slotNames holds the identifier of every slot assigned by the parser
+	static BytecodeProgram compile(const Instruction& mainSequence, const std::vector<std::string>& slotNames);
+};
\ No newline at end of file
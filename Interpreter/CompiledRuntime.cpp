@@ -0,0 +1,232 @@
+#include "CompiledRuntime.h"
+#include "Instruction.h"
+#include "Interpreter Error Flags.h"
+
+#include <utility>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+CompiledRuntime::CompiledRuntime(const char* const* names, size_t slots, const CompiledFunction* functions, size_t memoTables) : environment(slots)
+{
+	this->names = names;
+	this->functions = functions;
+	program = nullptr;
+	tailCall = -1;
+	state = InterpreterErrorFlags::normalStateFlag;
+	environment.memoCaches.resize(memoTables);
+	environment.callLimit = defaultCallLimit;
+}
+
+bool CompiledRuntime::load(int slot, Number& value)
+{
+	const Binding& binding = environment.lookup(slot);
+	if (binding.kind != Binding::numberBinding) return undefinedVariable(slot);
+
+	value = binding.number;
+	return true;
+}
+
+bool CompiledRuntime::read(Number& value)
+{
+	std::cout << "> ";
+	std::string input;
+	std::cin >> input;
+	if (Instruction::convertNumber(input, value)) return true;
+
+	state = InterpreterErrorFlags::invalidInputFlag;
+	return false;
+}
+
+void CompiledRuntime::print(const Number& value)
+{
+	std::cout << value << '\n';
+}
+
+bool CompiledRuntime::divide(Number& dividend, const Number& divider)
+{
+	if (divider.isZero())
+	{
+		state = InterpreterErrorFlags::divisionByZeroFlag;
+		return false;
+	}
+
+	dividend /= divider;
+	return true;
+}
+
+bool CompiledRuntime::modulo(Number& dividend, const Number& divider)
+{
+	if (divider.isZero())
+	{
+		state = InterpreterErrorFlags::divisionByZeroFlag;
+		return false;
+	}
+
+	dividend %= divider;
+	return true;
+}
+
+bool CompiledRuntime::divideModulo(const Number& dividend, const Number& divider, Number& quotient, Number& remainder)
+{
+	if (divider.isZero())
+	{
+		state = InterpreterErrorFlags::divisionByZeroFlag;
+		return false;
+	}
+
+	dividend.divmod(divider, quotient, remainder);
+	return true;
+}
+
+bool CompiledRuntime::checkFunction(int slot)
+{
+	if (environment.lookup(slot).kind == Binding::functionBinding) return true;
+
+	state = InterpreterErrorFlags::undefinedFunctionFlag;
+	undefinedObject = names[slot];
+	return false;
+}
+
+bool CompiledRuntime::call(int slot, Number& argument, Number& result)
+{
+	const CompiledFunction& called = functions[environment.lookup(slot).function];
+	MemoCache* memo = nullptr;
+	Number memoArgument;
+
+	if (called.memoTable >= 0)
+	{
+		memo = &environment.memoCaches[called.memoTable];
+		const Number* cached = memo->find(argument);
+		if (cached)
+		{
+			result = *cached;
+			return true;
+		}
+		memoArgument = argument;
+	}
+
+	if (environment.depth() > environment.callLimit)
+	{
+		state = InterpreterErrorFlags::recursionLimitFlag;
+		return false;
+	}
+
+	environment.pushFrame();
+
+	/// Tail calls of the body continue here in the same frame, with the argument
+	/// handed back as the result. They are not counted toward the call limit.
+	const CompiledFunction* function = &called;
+	bool success;
+	while (true)
+	{
+		if (function->parameter >= 0) environment.defineNumber(function->parameter, std::move(argument));
+
+		tailCall = -1;
+		success = function->body(*this, argument, result);
+		if (!success || tailCall < 0) break;
+
+		function = &functions[environment.lookup(tailCall).function];
+		argument = std::move(result);
+	}
+
+	environment.popFrame();
+
+	if (success && memo) memo->insert(memoArgument, result);
+	return success;
+}
+
+bool CompiledRuntime::undefinedVariable(int slot)
+{
+	state = InterpreterErrorFlags::undefinedVariableFlag;
+	undefinedObject = names[slot];
+	return false;
+}
+
+bool CompiledRuntime::lackOfReturnValue(int slot)
+{
+	state = InterpreterErrorFlags::lackOfReturnValue;
+	undefinedObject = names[slot];
+	return false;
+}
+
+void CompiledRuntime::runProgram()
+{
+	environment.pushFrame();
+	program(*this);
+	environment.popFrame();
+}
+
+#if defined(_WIN32)
+unsigned long __stdcall CompiledRuntime::programThread(void* runtime)
+{
+	((CompiledRuntime*)runtime)->runProgram();
+	return 0;
+}
+#else
+void* CompiledRuntime::programThread(void* runtime)
+{
+	((CompiledRuntime*)runtime)->runProgram();
+	return nullptr;
+}
+#endif
+
+void CompiledRuntime::report()
+{
+	switch (state)
+	{
+	case InterpreterErrorFlags::normalStateFlag:
+		std::cout << "The program ended successfully!\n";
+		break;
+	case InterpreterErrorFlags::divisionByZeroFlag:
+		std::cout << "Division by zero occured!\n";
+		break;
+	case InterpreterErrorFlags::invalidInputFlag:
+		std::cout << "The given input is invalid!\n";
+		break;
+	case InterpreterErrorFlags::undefinedVariableFlag:
+		std::cout << "Variable " << undefinedObject << " is indefined!\n";
+		break;
+	case InterpreterErrorFlags::undefinedFunctionFlag:
+		std::cout << "Function " << undefinedObject << " is indefined!\n";
+		break;
+	case InterpreterErrorFlags::lackOfReturnValue:
+		std::cout << "Function " << undefinedObject << " failed to return a value!\n";
+		break;
+	case InterpreterErrorFlags::recursionLimitFlag:
+		std::cout << "The program made more than " << environment.callLimit << " nested calls!\n";
+		break;
+	}
+}
+
+int CompiledRuntime::run(bool (*program)(CompiledRuntime&), const char* const* names, size_t slots, const CompiledFunction* functions, size_t memoTables)
+{
+	CompiledRuntime runtime(names, slots, functions, memoTables);
+	runtime.program = program;
+
+	/// The stack is only reserved, pages are committed as the recursion reaches them.
+	/// Without a thread of that size the program runs on the current stack.
+#if defined(_WIN32)
+	HANDLE thread = CreateThread(nullptr, stackSize, programThread, &runtime, STACK_SIZE_PARAM_IS_A_RESERVATION, nullptr);
+	if (thread)
+	{
+		WaitForSingleObject(thread, INFINITE);
+		CloseHandle(thread);
+	}
+	else runtime.runProgram();
+#else
+	pthread_attr_t attributes;
+	pthread_t thread;
+	pthread_attr_init(&attributes);
+	pthread_attr_setstacksize(&attributes, stackSize);
+	if (!pthread_create(&thread, &attributes, programThread, &runtime)) pthread_join(thread, nullptr);
+	else runtime.runProgram();
+	pthread_attr_destroy(&attributes);
+#endif
+
+	runtime.report();
+	return 0;
+}
\ No newline at end of file
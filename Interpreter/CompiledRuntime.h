@@ -0,0 +1,70 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+
+#include "Number.h"
+#include "Environment.h"
+
+class CompiledRuntime;
+
+/// A function of a program translated by CppGenerator
+struct CompiledFunction
+{
+	/// Runs the body on the argument, returns false on an error
+	bool (*body)(CompiledRuntime&, Number& argument, Number& result);
+	/// Slot the argument is bound to, -1 if the body keeps it in a local
+	int parameter;
+	/// Memo table of a pure recdef, -1 otherwise
+	int memoTable;
+};
+
+/// Support code linked into programs translated by CppGenerator. It holds the
+/// bindings that are not C++ locals and reports errors with the messages of the
+/// interpreter.
+class CompiledRuntime
+{
+private:
+	/// Stack reserved for the program, its calls are native calls
+	const static size_t stackSize = (size_t)1 << 30;
+	const static size_t defaultCallLimit = 1000000;
+
+	const char* const* names;
+	const CompiledFunction* functions;
+	bool (*program)(CompiledRuntime&);
+
+	CompiledRuntime(const char* const* names, size_t slots, const CompiledFunction* functions, size_t memoTables);
+
+	void runProgram();
+	void report();
+
+#if defined(_WIN32)
+	static unsigned long __stdcall programThread(void*);
+#else
+	static void* programThread(void*);
+#endif
+
+public:
+	char state;
+	std::string undefinedObject;
+	Environment environment;
+	/// Slot of the function a body hands its tail call to, -1 when it returned a value
+	int tailCall;
+
+	bool load(int slot, Number& value);
+	bool read(Number& value);
+	void print(const Number& value);
+	bool divide(Number& dividend, const Number& divider);
+	bool modulo(Number& dividend, const Number& divider);
+	bool divideModulo(const Number& dividend, const Number& divider, Number& quotient, Number& remainder);
+
+	bool checkFunction(int slot);
+	bool call(int slot, Number& argument, Number& result);
+
+	/// Error helpers, they set the state and return false
+	bool undefinedVariable(int slot);
+	bool lackOfReturnValue(int slot);
+
+	/// Runs a translated program on a thread with a large stack and prints how it ended
+	static int run(bool (*program)(CompiledRuntime&), const char* const* names, size_t slots, const CompiledFunction* functions, size_t memoTables);
+};
\ No newline at end of file
@@ -0,0 +1,586 @@
+#include "CppGenerator.h"
+
+CppGenerator::CppGenerator(const std::vector<std::string>& names, const std::vector<int>& invariantLoops) : slotNames(names)
+{
+	this->invariantLoops = invariantLoops;
+	storage.assign(names.size(), environmentStorage);
+	readSlots.assign(names.size(), false);
+	temporaries = 0;
+}
+
+void CppGenerator::collectDefinitions(const Instruction& Ins)
+{
+	if (Ins.type == Instruction::functionDefinitionType || Ins.type == Instruction::recursiveFunctionDefinitionType)
+	{
+		definitionIndices[&Ins] = definitions.size();
+		definitions.push_back(&Ins);
+	}
+
+	for (size_t i = 0; i < Ins.parameters.size(); i++) collectDefinitions(Ins.parameters[i]);
+}
+
+void CppGenerator::collectUses(const Instruction& Ins, int context, std::vector<std::set<int>>& uses)
+{
+	switch (Ins.type)
+	{
+	case Instruction::functionDefinitionType:
+	case Instruction::recursiveFunctionDefinitionType:
+	{
+		/// The body runs in the frame of its own calls
+		int function = definitionIndices[&Ins];
+		uses[Ins.parameters[1].slot].insert(function);
+		collectUses(Ins.parameters[2], function, uses);
+		return;
+	}
+	case Instruction::variableNameType:
+		uses[Ins.slot].insert(context);
+		return;
+	default:
+		break;
+	}
+
+	for (size_t i = 0; i < Ins.parameters.size(); i++) collectUses(Ins.parameters[i], context, uses);
+}
+
+void CppGenerator::assignStorage(const Instruction& mainSequence)
+{
+	std::vector<std::set<int>> uses(slotNames.size());
+	collectUses(mainSequence, -1, uses);
+
+	for (size_t slot = 0; slot < uses.size(); slot++)
+	{
+		if (uses[slot].empty()) continue;
+		if (uses[slot].size() == 1 && *uses[slot].begin() < 0)
+		{
+			storage[slot] = mainStorage;
+			continue;
+		}
+
+		/// A parameter shared by several functions is still local when each of them only reads its own
+		bool ownParameter = true;
+		for (std::set<int>::const_iterator context = uses[slot].begin(); context != uses[slot].end(); ++context)
+		{
+			if (*context < 0 || definitions[*context]->parameters[1].slot != (int)slot) ownParameter = false;
+		}
+		if (ownParameter) storage[slot] = parameterStorage;
+	}
+}
+
+void CppGenerator::collectReads(const Instruction& Ins)
+{
+	switch (Ins.type)
+	{
+	case Instruction::functionDefinitionType:
+	case Instruction::recursiveFunctionDefinitionType:
+		/// Functions do not see the slots of the main code
+		return;
+	case Instruction::variableNameType:
+		readSlots[Ins.slot] = true;
+		return;
+	case Instruction::readType:
+	case Instruction::variableDefinitionType:
+		/// The first parameter is the slot stored to
+		for (size_t i = 1; i < Ins.parameters.size(); i++) collectReads(Ins.parameters[i]);
+		return;
+	default:
+		break;
+	}
+
+	for (size_t i = 0; i < Ins.parameters.size(); i++) collectReads(Ins.parameters[i]);
+}
+
+std::string CppGenerator::temporary(const char* prefix)
+{
+	std::ostringstream name;
+	name << prefix << temporaries++;
+	return name.str();
+}
+
+std::string CppGenerator::constant(const Number& value)
+{
+	std::ostringstream digits;
+	digits << value;
+
+	std::map<std::string, int>::const_iterator found = constantIndices.find(digits.str());
+	int index = (found != constantIndices.end() ? found->second : (int)constants.size());
+	if (found == constantIndices.end())
+	{
+		constantIndices[digits.str()] = index;
+		constants.push_back(digits.str());
+	}
+
+	std::ostringstream name;
+	name << "constants[" << index << ']';
+	return name.str();
+}
+
+void CppGenerator::indent(int depth)
+{
+	for (int i = 0; i < depth; i++) code << '\t';
+}
+
+void CppGenerator::declareInvariants(const Instruction& Ins, int loop, int depth)
+{
+	if (Ins.type == Instruction::invariantType && invariantLoops[Ins.cacheEntry] == loop)
+	{
+		indent(depth);
+		code << "Number invariant" << Ins.cacheEntry << ";\n";
+		indent(depth);
+		code << "bool cached" << Ins.cacheEntry << " = false;\n";
+	}
+	if (Ins.type == Instruction::functionDefinitionType || Ins.type == Instruction::recursiveFunctionDefinitionType) return;
+
+	for (size_t i = 0; i < Ins.parameters.size(); i++) declareInvariants(Ins.parameters[i], loop, depth);
+}
+
+bool CppGenerator::directOperand(const Instruction& Ins, std::string& expression, int depth)
+{
+	/// Values that can be used in place, without copying them to a temporary
+	if (Ins.type == Instruction::numberType)
+	{
+		expression = constant(Ins.number);
+		return true;
+	}
+	if (Ins.type == Instruction::inlineArgumentType)
+	{
+		expression = inlineArguments[Ins.argument];
+		return true;
+	}
+	if (Ins.type == Instruction::invariantType)
+	{
+		indent(depth);
+		code << "if (!cached" << Ins.cacheEntry << ")\n";
+		indent(depth);
+		code << "{\n";
+		emitValue(Ins.parameters[0], "invariant" + std::to_string(Ins.cacheEntry), depth + 1);
+		indent(depth + 1);
+		code << "cached" << Ins.cacheEntry << " = true;\n";
+		indent(depth);
+		code << "}\n";
+		expression = "invariant" + std::to_string(Ins.cacheEntry);
+		return true;
+	}
+	if (Ins.type != Instruction::variableNameType || storage[Ins.slot] == environmentStorage) return false;
+
+	if (storage[Ins.slot] == parameterStorage)
+	{
+		expression = "argument";
+		return true;
+	}
+
+	indent(depth);
+	code << "if (!defined" << Ins.slot << ") return runtime.undefinedVariable(" << Ins.slot << ");\n";
+	expression = "variable" + std::to_string(Ins.slot);
+	return true;
+}
+
+void CppGenerator::emitValue(const Instruction& Ins, const std::string& target, int depth)
+{
+	std::string expression;
+
+	switch (Ins.type)
+	{
+	case Instruction::numberType:
+	case Instruction::inlineArgumentType:
+	case Instruction::invariantType:
+	case Instruction::variableNameType:
+	{
+		if (directOperand(Ins, expression, depth))
+		{
+			indent(depth);
+			code << target << " = " << expression << ";\n";
+			break;
+		}
+
+		indent(depth);
+		code << "if (!runtime.load(" << Ins.slot << ", " << target << ")) return false;\n";
+		break;
+	}
+	case Instruction::arithmeticType:
+	{
+		emitValue(Ins.parameters[0], target, depth);
+
+		std::string second;
+		if (!directOperand(Ins.parameters[1], second, depth))
+		{
+			second = temporary("value");
+			indent(depth);
+			code << "Number " << second << ";\n";
+			emitValue(Ins.parameters[1], second, depth);
+		}
+
+		indent(depth);
+		switch (Ins.operation)
+		{
+		case '+':
+			code << target << " += " << second << ";\n";
+			break;
+		case '-':
+			code << target << " -= " << second << ";\n";
+			break;
+		case '*':
+			code << "Number::multiply(" << target << ", " << second << ", " << target << ");\n";
+			break;
+		case '/':
+			code << "if (!runtime.divide(" << target << ", " << second << ")) return false;\n";
+			break;
+		case '%':
+			code << "if (!runtime.modulo(" << target << ", " << second << ")) return false;\n";
+			break;
+		}
+		break;
+	}
+	case Instruction::functionCallType:
+	{
+		/// The function has to be defined before its argument is evaluated
+		int name = Ins.parameters[0].slot;
+		std::string argument = temporary("argument");
+
+		indent(depth);
+		code << "if (!runtime.checkFunction(" << name << ")) return false;\n";
+		indent(depth);
+		code << "Number " << argument << ";\n";
+		emitValue(Ins.parameters[1], argument, depth);
+		indent(depth);
+		code << "if (!runtime.call(" << name << ", " << argument << ", " << target << ")) return false;\n";
+		break;
+	}
+	case Instruction::inlineCallType:
+	{
+		std::string argument = temporary("argument");
+		indent(depth);
+		code << "Number " << argument << ";\n";
+		emitValue(Ins.parameters[0], argument, depth);
+
+		inlineArguments[Ins.argument] = argument;
+		emitValue(Ins.parameters[1], target, depth);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+std::string CppGenerator::emitCondition(const Instruction& Ins, int depth)
+{
+	if (Ins.type == Instruction::basicBooleanType) return Ins.booleanValue ? "true" : "false";
+
+	switch (Ins.operation)
+	{
+	case '!':
+		return "!" + emitCondition(Ins.parameters[0], depth);
+	case '&':
+	case '|':
+	{
+		/// The second condition is evaluated only when the first one does not decide the result
+		std::string result = temporary("condition");
+		std::string first = emitCondition(Ins.parameters[0], depth);
+		indent(depth);
+		code << "bool " << result << " = " << first << ";\n";
+		indent(depth);
+		code << (Ins.operation == '&' ? "if (" : "if (!") << result << ")\n";
+		indent(depth);
+		code << "{\n";
+		std::string second = emitCondition(Ins.parameters[1], depth + 1);
+		indent(depth + 1);
+		code << result << " = " << second << ";\n";
+		indent(depth);
+		code << "}\n";
+		return result;
+	}
+	default:
+	{
+		std::string operands[2];
+		for (int i = 0; i < 2; i++)
+		{
+			if (directOperand(Ins.parameters[i], operands[i], depth)) continue;
+
+			operands[i] = temporary("value");
+			indent(depth);
+			code << "Number " << operands[i] << ";\n";
+			emitValue(Ins.parameters[i], operands[i], depth);
+		}
+
+		const char* comparison = (Ins.operation == '<' ? " < " : Ins.operation == '>' ? " > " : " == ");
+		return "(" + operands[0] + comparison + operands[1] + ")";
+	}
+	}
+}
+
+void CppGenerator::emitStore(int slot, const std::string& value, int depth)
+{
+	indent(depth);
+	switch (storage[slot])
+	{
+	case environmentStorage:
+		code << "runtime.environment.defineNumber(" << slot << ", std::move(" << value << "));\n";
+		break;
+	case mainStorage:
+		code << "variable" << slot << " = std::move(" << value << ");\n";
+		if (!readSlots[slot]) break;
+		indent(depth);
+		code << "defined" << slot << " = true;\n";
+		break;
+	case parameterStorage:
+		code << "argument = std::move(" << value << ");\n";
+		break;
+	}
+}
+
+void CppGenerator::emitSequence(const Instruction& sequence, int depth)
+{
+	for (size_t i = 0; i < sequence.parameters.size(); i++)
+	{
+		if (i + 1 < sequence.parameters.size() && sequence.parameters[i].pairsDivision(sequence.parameters[i + 1]))
+		{
+			emitDivisionPair(sequence.parameters[i], sequence.parameters[i + 1], depth);
+			i++;
+		}
+		else emitStatement(sequence.parameters[i], depth);
+	}
+}
+
+void CppGenerator::emitDivisionPair(const Instruction& first, const Instruction& second, int depth)
+{
+	const Instruction& division = first.parameters[1];
+	indent(depth);
+	code << "{\n";
+
+	std::string operands[2];
+	for (int i = 0; i < 2; i++)
+	{
+		if (directOperand(division.parameters[i], operands[i], depth + 1)) continue;
+
+		operands[i] = temporary("value");
+		indent(depth + 1);
+		code << "Number " << operands[i] << ";\n";
+		emitValue(division.parameters[i], operands[i], depth + 1);
+	}
+
+	std::string quotient = temporary("quotient");
+	std::string remainder = temporary("remainder");
+	indent(depth + 1);
+	code << "Number " << quotient << ", " << remainder << ";\n";
+	indent(depth + 1);
+	code << "if (!runtime.divideModulo(" << operands[0] << ", " << operands[1] << ", " << quotient << ", " << remainder << ")) return false;\n";
+
+	bool quotientFirst = (division.operation == '/');
+	emitStore(first.parameters[0].slot, quotientFirst ? quotient : remainder, depth + 1);
+	emitStore(second.parameters[0].slot, quotientFirst ? remainder : quotient, depth + 1);
+
+	indent(depth);
+	code << "}\n";
+}
+
+void CppGenerator::emitStatement(const Instruction& Ins, int depth)
+{
+	switch (Ins.type)
+	{
+	case Instruction::sequenceType:
+		emitSequence(Ins, depth);
+		return;
+	case Instruction::functionDefinitionType:
+	case Instruction::recursiveFunctionDefinitionType:
+		indent(depth);
+		code << "runtime.environment.defineFunction(" << Ins.parameters[0].slot << ", " << definitionIndices[&Ins] << ");\n";
+		return;
+	case Instruction::defaultType:
+		return;
+	default:
+		break;
+	}
+
+	/// Every other statement gets a block, so its temporaries end with it
+	indent(depth);
+	code << "{\n";
+
+	switch (Ins.type)
+	{
+	case Instruction::ifStatementType:
+	{
+		std::string condition = emitCondition(Ins.parameters[0], depth + 1);
+		indent(depth + 1);
+		code << "if (" << condition << ")\n";
+		indent(depth + 1);
+		code << "{\n";
+		emitSequence(Ins.parameters[1], depth + 2);
+		indent(depth + 1);
+		code << "}\n";
+		indent(depth + 1);
+		code << "else\n";
+		indent(depth + 1);
+		code << "{\n";
+		emitSequence(Ins.parameters[2], depth + 2);
+		indent(depth + 1);
+		code << "}\n";
+		break;
+	}
+	case Instruction::whileStatementType:
+	case Instruction::countedWhileType:
+	{
+		/// The caches of the invariants of the loop are filled again every time it starts
+		if (Ins.loop >= 0) declareInvariants(Ins, Ins.loop, depth + 1);
+		indent(depth + 1);
+		code << "while (true)\n";
+		indent(depth + 1);
+		code << "{\n";
+		std::string condition = emitCondition(Ins.parameters[0], depth + 2);
+		indent(depth + 2);
+		code << "if (!" << condition << ") break;\n";
+		emitSequence(Ins.parameters[1], depth + 2);
+		indent(depth + 1);
+		code << "}\n";
+		break;
+	}
+	case Instruction::readType:
+	{
+		std::string value = temporary("value");
+		indent(depth + 1);
+		code << "Number " << value << ";\n";
+		indent(depth + 1);
+		code << "if (!runtime.read(" << value << ")) return false;\n";
+		emitStore(Ins.parameters[0].slot, value, depth + 1);
+		break;
+	}
+	case Instruction::printType:
+	{
+		std::string value;
+		if (!directOperand(Ins.parameters[0], value, depth + 1))
+		{
+			value = temporary("value");
+			indent(depth + 1);
+			code << "Number " << value << ";\n";
+			emitValue(Ins.parameters[0], value, depth + 1);
+		}
+		indent(depth + 1);
+		code << "runtime.print(" << value << ");\n";
+		break;
+	}
+	case Instruction::returnType:
+		if (Ins.parameters[0].type == Instruction::tailCallType)
+		{
+			/// The argument is handed back as the result, CompiledRuntime::call runs the function
+			const Instruction& call = Ins.parameters[0];
+			indent(depth + 1);
+			code << "if (!runtime.checkFunction(" << call.parameters[0].slot << ")) return false;\n";
+			emitValue(call.parameters[1], "result", depth + 1);
+			indent(depth + 1);
+			code << "runtime.tailCall = " << call.parameters[0].slot << ";\n";
+			indent(depth + 1);
+			code << "return true;\n";
+			break;
+		}
+		emitValue(Ins.parameters[0], "result", depth + 1);
+		indent(depth + 1);
+		code << "return true;\n";
+		break;
+	case Instruction::counterStepType:
+	{
+		std::string value = temporary("value");
+		indent(depth + 1);
+		code << "Number " << value << ";\n";
+		emitValue(Ins.parameters[0], value, depth + 1);
+		indent(depth + 1);
+		code << value << " += " << constant(Ins.parameters[1].number) << ";\n";
+		emitStore(Ins.parameters[0].slot, value, depth + 1);
+		break;
+	}
+	case Instruction::variableDefinitionType:
+	{
+		std::string value = temporary("value");
+		indent(depth + 1);
+		code << "Number " << value << ";\n";
+		emitValue(Ins.parameters[1], value, depth + 1);
+		emitStore(Ins.parameters[0].slot, value, depth + 1);
+		break;
+	}
+	default:
+		break;
+	}
+
+	indent(depth);
+	code << "}\n";
+}
+
+void CppGenerator::emitFunction(int index)
+{
+	const Instruction& definition = *definitions[index];
+
+	code << "\n/// " << slotNames[definition.parameters[0].slot] << '[' << slotNames[definition.parameters[1].slot] << "]\n";
+	code << "static bool function" << index << "(CompiledRuntime& runtime, Number& argument, Number& result)\n{\n";
+
+	if (definition.type == Instruction::functionDefinitionType)
+	{
+		emitValue(definition.parameters[2], "result", 1);
+		code << "\treturn true;\n";
+	}
+	else
+	{
+		emitSequence(definition.parameters[2], 1);
+		code << "\treturn runtime.lackOfReturnValue(" << definition.parameters[0].slot << ");\n";
+	}
+
+	code << "}\n";
+}
+
+void CppGenerator::generate(const Instruction& mainSequence, const std::vector<std::string>& slotNames, const std::vector<int>& invariantLoops, std::ostream& source)
+{
+	CppGenerator generator(slotNames, invariantLoops);
+	generator.collectDefinitions(mainSequence);
+	generator.assignStorage(mainSequence);
+	generator.collectReads(mainSequence);
+
+	int memoTables = 0;
+	for (size_t i = 0; i < generator.definitions.size(); i++)
+	{
+		generator.emitFunction(i);
+		if (generator.definitions[i]->type == Instruction::recursiveFunctionDefinitionType && generator.definitions[i]->memoTable >= memoTables)
+		{
+			memoTables = generator.definitions[i]->memoTable + 1;
+		}
+	}
+
+	generator.code << "\nstatic bool program(CompiledRuntime& runtime)\n{\n";
+	for (size_t slot = 0; slot < slotNames.size(); slot++)
+	{
+		if (generator.storage[slot] != mainStorage) continue;
+		generator.code << "\tNumber variable" << slot << ";\n";
+		if (generator.readSlots[slot]) generator.code << "\tbool defined" << slot << " = false;\n";
+	}
+	generator.emitSequence(mainSequence, 1);
+	generator.code << "\treturn true;\n}\n";
+
+	source << "/// Generated by exprc, the names of the program are kept in comments.\n";
+	source << "#include \"CompiledRuntime.h\"\n\n#include <utility>\n\n";
+
+	source << "static const char* const names[] = {";
+	for (size_t slot = 0; slot < slotNames.size(); slot++) source << '"' << slotNames[slot] << "\", ";
+	source << "nullptr};\n";
+	if (!generator.constants.empty()) source << "static Number constants[" << generator.constants.size() << "];\n";
+	source << '\n';
+
+	for (size_t i = 0; i < generator.definitions.size(); i++)
+	{
+		source << "static bool function" << i << "(CompiledRuntime&, Number&, Number&);\n";
+	}
+
+	source << "\nstatic const CompiledFunction functions[] =\n{\n";
+	for (size_t i = 0; i < generator.definitions.size(); i++)
+	{
+		const Instruction& definition = *generator.definitions[i];
+		int parameter = definition.parameters[1].slot;
+		int memoTable = (definition.type == Instruction::recursiveFunctionDefinitionType ? definition.memoTable : -1);
+
+		source << "\t{function" << i << ", " << (generator.storage[parameter] == parameterStorage ? -1 : parameter) << ", " << memoTable << "},\n";
+	}
+	source << "\t{nullptr, -1, -1}\n};\n";
+
+	source << generator.code.str();
+
+	source << "\nint main()\n{\n";
+	for (size_t i = 0; i < generator.constants.size(); i++)
+	{
+		source << "\tconstants[" << i << "] = Number(std::string(\"" << generator.constants[i] << "\"));\n";
+	}
+	source << "\treturn CompiledRuntime::run(program, names, " << slotNames.size() << ", functions, " << memoTables << ");\n}\n";
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Instruction.h"
+
+/// Translates a parsed program to C++ that runs on CompiledRuntime.
+///
+/// Every function definition becomes a C++ function. Calls still go through the
+/// binding of the called name, because a name may be bound to different
+/// definitions as the program runs. A returned call is handed back to
+/// CompiledRuntime::call, which runs it in the frame of the caller. Variables that only the main code uses become
+/// locals of the program function. A parameter that is used only by the body of
+/// its function stays in the C++ argument. Any other name may be read by a called
+/// function under dynamic scoping, so it is kept in Environment as in the engines.
+class CppGenerator
+{
+private:
+	enum SlotStorage : unsigned char
+	{
+		environmentStorage,
+		mainStorage,
+		parameterStorage
+	};
+
+	const std::vector<std::string>& slotNames;
+	std::vector<SlotStorage> storage;
+	/// Function definitions in the order of their C++ functions
+	std::vector<const Instruction*> definitions;
+	std::map<const Instruction*, int> definitionIndices;
+	/// Decimal digits of every distinct constant of the program, and their indices
+	std::vector<std::string> constants;
+	std::map<std::string, int> constantIndices;
+	/// Slots read by the main code, which keep a flag of whether they are defined
+	std::vector<bool> readSlots;
+	/// Locals holding the arguments of inlined calls, by call site
+	std::map<int, std::string> inlineArguments;
+	/// Loop of every invariant cache, from LoopOptimizer
+	std::vector<int> invariantLoops;
+	std::ostringstream code;
+	int temporaries;
+
+	CppGenerator(const std::vector<std::string>&, const std::vector<int>& invariantLoops);
+
+	void collectDefinitions(const Instruction&);
+	void collectUses(const Instruction&, int context, std::vector<std::set<int>>& uses);
+	void assignStorage(const Instruction& mainSequence);
+	void collectReads(const Instruction&);
+
+	std::string temporary(const char* prefix);
+	std::string constant(const Number&);
+	void indent(int depth);
+	void declareInvariants(const Instruction&, int loop, int depth);
+
+	bool directOperand(const Instruction&, std::string& expression, int depth);
+	void emitValue(const Instruction&, const std::string& target, int depth);
+	std::string emitCondition(const Instruction&, int depth);
+	void emitStore(int slot, const std::string& value, int depth);
+	void emitSequence(const Instruction&, int depth);
+	void emitDivisionPair(const Instruction& first, const Instruction& second, int depth);
+	void emitStatement(const Instruction&, int depth);
+	void emitFunction(int index);
+
+public:
+	static void generate(const Instruction& mainSequence, const std::vector<std::string>& slotNames, const std::vector<int>& invariantLoops, std::ostream& source);
+};
\ No newline at end of file
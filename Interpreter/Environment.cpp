@@ -0,0 +1,103 @@
+#include "Environment.h"
+
+#include <utility>
+
+Binding::Binding()
+{
+	kind = undefinedBinding;
+	function = -1;
+	definition = nullptr;
+	frame = -1;
+}
+
+Binding& Environment::bindInFrame(int slot)
+{
+	Binding& binding = bindings[slot];
+	int frame = frameStarts.size() - 1;
+
+	/// A binding stamped with the current depth was made by this frame: bindings
+	/// of deeper frames that have already been left were restored when they ended.
+	if (binding.frame == frame) return binding;
+
+	savedBindings.emplace_back();
+	savedBindings.back().slot = slot;
+	std::swap(savedBindings.back().binding, binding);
+	binding.frame = frame;
+
+	return binding;
+}
+
+Environment::Environment(size_t slots) : bindings(slots)
+{
+	tailCall = nullptr;
+	functionVersion = 1;
+	callLimit = (size_t)-1;
+}
+
+const Binding& Environment::lookup(int slot) const
+{
+	return bindings[slot];
+}
+
+Number* Environment::localNumber(int slot)
+{
+	Binding& binding = bindings[slot];
+
+	if (binding.kind != Binding::numberBinding || binding.frame != (int)frameStarts.size() - 1) return nullptr;
+	return &binding.number;
+}
+
+void Environment::defineNumber(int slot, const Number& value)
+{
+	Binding& binding = bindInFrame(slot);
+	binding.kind = Binding::numberBinding;
+	binding.number = value;
+}
+
+void Environment::defineNumber(int slot, Number&& value)
+{
+	Binding& binding = bindInFrame(slot);
+	binding.kind = Binding::numberBinding;
+	binding.number = std::move(value);
+}
+
+void Environment::defineFunction(int slot, int function)
+{
+	Binding& binding = bindInFrame(slot);
+	binding.kind = Binding::functionBinding;
+	functionVersion++;
+	binding.function = function;
+}
+
+void Environment::defineFunction(int slot, const Instruction* definition)
+{
+	Binding& binding = bindInFrame(slot);
+	binding.kind = Binding::functionBinding;
+	functionVersion++;
+	binding.definition = definition;
+}
+
+size_t Environment::depth() const
+{
+	return frameStarts.size();
+}
+
+void Environment::pushFrame()
+{
+	frameStarts.push_back(savedBindings.size());
+}
+
+void Environment::popFrame()
+{
+	size_t start = frameStarts.back();
+
+	while (savedBindings.size() > start)
+	{
+		Binding& binding = bindings[savedBindings.back().slot];
+		if (binding.kind == Binding::functionBinding || savedBindings.back().binding.kind == Binding::functionBinding) functionVersion++;
+
+		std::swap(binding, savedBindings.back().binding);
+		savedBindings.pop_back();
+	}
+	frameStarts.pop_back();
+}
\ No newline at end of file
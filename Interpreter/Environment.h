@@ -0,0 +1,106 @@
+#pragma once
+
+#include <vector>
+
+#include "Number.h"
+#include "MemoCache.h"
+
+class Instruction;
+
+/// What an identifier is bound to at runtime.
+struct Binding
+{
+	enum BindingKind : unsigned char
+	{
+		undefinedBinding,
+		numberBinding,
+		functionBinding
+	};
+
+	BindingKind kind;
+	Number number;
+	/// The function as compiled by BytecodeCompiler, or its definition in the parsed
+	/// program for the tree walker; the program is not modified while it runs, so
+	/// every binding of a definition shares that node
+	int function;
+	const Instruction* definition;
+	/// Depth of the frame that made this binding, -1 for none
+	int frame;
+
+	Binding();
+};
+
+/// Identifier bindings addressed by slot, with the scoping rules of EXPR: a name
+/// assigned for the first time in a frame shadows the outer binding until the
+/// frame is left, assigning it again in the same frame overwrites it.
+///
+/// The current binding of every slot is kept in place and each frame records
+/// the bindings it shadowed, so lookups, definitions and pushing a frame take
+/// constant time and leaving a frame costs one swap per name it bound.
+class Environment
+{
+private:
+	struct SavedBinding
+	{
+		int slot;
+		Binding binding;
+	};
+
+	std::vector<Binding> bindings;
+	/// Bindings shadowed by the open frames, oldest first; frameStarts[i] is where
+	/// the part of frame i begins
+	std::vector<SavedBinding> savedBindings;
+	std::vector<size_t> frameStarts;
+
+	Binding& bindInFrame(int);
+
+public:
+	/// Call the tree walker has to continue with in the current frame, set by a tail call
+	const Instruction* tailCall;
+	/// Results of the pure recdef functions, by their memo table index
+	std::vector<MemoCache> memoCaches;
+
+	/// Value of a loop invariant, valid while the epoch of its loop is unchanged
+	struct InvariantCache
+	{
+		Number value;
+		unsigned long long epoch;
+		int loop;
+	};
+
+	/// Incremented every time the loop starts, by loop index
+	std::vector<unsigned long long> loopEpochs;
+	std::vector<InvariantCache> invariantCaches;
+	/// Argument of every inlined call site
+	std::vector<Number> inlineArguments;
+
+	/// Definition a call site resolved to, valid while functionVersion is unchanged
+	struct CallSiteCache
+	{
+		const Instruction* definition;
+		unsigned long long version;
+	};
+
+	/// Incremented whenever a function binding is made, replaced or restored
+	unsigned long long functionVersion;
+	std::vector<CallSiteCache> callSites;
+
+	/// Most calls that may be open at once
+	size_t callLimit;
+
+	Environment(size_t = 0);
+
+	const Binding& lookup(int slot) const;
+	/// The number bound to slot if the current frame made that binding, otherwise nullptr
+	Number* localNumber(int slot);
+
+	void defineNumber(int slot, const Number&);
+	void defineNumber(int slot, Number&&);
+	void defineFunction(int slot, int function);
+	void defineFunction(int slot, const Instruction* definition);
+
+	/// Number of open frames, the main code included
+	size_t depth() const;
+	void pushFrame();
+	void popFrame();
+};
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include "Inliner.h"
+
+#include <utility>
+
+Inliner::Inliner()
+{
+	arguments = 0;
+}
+
+void Inliner::countDefinitions(const Instruction& Ins, std::map<int, int>& definitions)
+{
+	if (Ins.type == Instruction::functionDefinitionType || Ins.type == Instruction::recursiveFunctionDefinitionType)
+	{
+		definitions[Ins.parameters[0].slot]++;
+	}
+
+	for (size_t i = 0; i < Ins.parameters.size(); i++) countDefinitions(Ins.parameters[i], definitions);
+}
+
+void Inliner::replaceParameter(Instruction& Ins, int parameter, const Instruction& replacement)
+{
+	if (Ins.type == Instruction::variableNameType && Ins.slot == parameter)
+	{
+		Ins = replacement;
+		return;
+	}
+
+	for (size_t i = 0; i < Ins.parameters.size(); i++) replaceParameter(Ins.parameters[i], parameter, replacement);
+}
+
+void Inliner::inlineCall(Instruction& call, const Instruction& definition)
+{
+	Instruction body = definition.parameters[2];
+	int parameter = definition.parameters[1].slot;
+
+	/// A literal cannot fail, so it may be substituted even if the parameter is unused
+	if (call.parameters[1].type == Instruction::numberType)
+	{
+		replaceParameter(body, parameter, call.parameters[1]);
+		call = std::move(body);
+		return;
+	}
+
+	Instruction argument(Instruction::inlineArgumentType);
+	argument.argument = arguments;
+	replaceParameter(body, parameter, argument);
+
+	Instruction inlined(Instruction::inlineCallType);
+	inlined.argument = arguments++;
+	inlined.parameters.push_back(std::move(call.parameters[1]));
+	inlined.parameters.push_back(std::move(body));
+	call = std::move(inlined);
+}
+
+void Inliner::inlineCalls(Instruction& Ins)
+{
+	for (size_t i = 0; i < Ins.parameters.size(); i++) inlineCalls(Ins.parameters[i]);
+
+	if (Ins.type != Instruction::functionCallType && Ins.type != Instruction::tailCallType) return;
+
+	std::map<int, const Instruction*>::const_iterator definition = inlinable.find(Ins.parameters[0].slot);
+	if (definition != inlinable.end()) inlineCall(Ins, *definition->second);
+}
+
+void Inliner::optimize(Instruction& mainSequence, int& inlineArguments)
+{
+	Inliner inliner;
+	std::map<int, int> definitions;
+	countDefinitions(mainSequence, definitions);
+
+	/// A definition is visible to the statements after it, its own body is inlined first
+	for (size_t i = 0; i < mainSequence.parameters.size(); i++)
+	{
+		Instruction& statement = mainSequence.parameters[i];
+		inliner.inlineCalls(statement);
+
+		if (statement.type != Instruction::functionDefinitionType) continue;
+		if (definitions[statement.parameters[0].slot] != 1 || statement.parameters[2].containsCall()) continue;
+		inliner.inlinable[statement.parameters[0].slot] = &statement;
+	}
+
+	inlineArguments = inliner.arguments;
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <map>
+
+#include "Instruction.h"
+
+/// Replaces calls of single-expression functions with their bodies, run before Optimizer.
+///
+/// A call is inlined only when the definition that reaches it is known: the function
+/// is defined once in the whole program, by a top-level statement of the main code
+/// that comes before the call, and its body calls no function. The main frame is never
+/// left, so such a definition stays in place until the program ends. Every other call
+/// keeps the generic path.
+///
+/// A literal argument is substituted into the body. Any other argument is evaluated
+/// once, before the body, and kept in Environment for the parameter to read.
+class Inliner
+{
+private:
+	int arguments;
+	/// Definitions known to reach the calls that follow, by function slot
+	std::map<int, const Instruction*> inlinable;
+
+	Inliner();
+
+	static void countDefinitions(const Instruction&, std::map<int, int>&);
+	static void replaceParameter(Instruction&, int parameter, const Instruction& replacement);
+
+	void inlineCall(Instruction&, const Instruction& definition);
+	void inlineCalls(Instruction&);
+
+public:
+	static void optimize(Instruction& mainSequence, int& inlineArguments);
+};
\ No newline at end of file
@@ -1,35 +1,59 @@
 #include "Instruction.h"
 
-const std::string Instruction::defaultType = "default";
-const std::string Instruction::sequenceType = "sequence";
-const std::string Instruction::ifStatementType = "if";
-const std::string Instruction::whileStatementType = "while";
-const std::string Instruction::readType = "read";
-const std::string Instruction::printType = "print";
-const std::string Instruction::returnType = "return";
-const std::string Instruction::booleanType = "boolean";
-const std::string Instruction::arithmeticType = "arithmetic";
-const std::string Instruction::basicBooleanType = "basic boolean";
-const std::string Instruction::numberType = "number";
-const std::string Instruction::variableNameType = "variable name";
-const std::string Instruction::functionNameType = "function name";
-const std::string Instruction::variableDefinitionType = "variable definition";
-const std::string Instruction::functionDefinitionType = "function definition";
-const std::string Instruction::recursiveFunctionDefinitionType = "recursive function definition";
-const std::string Instruction::functionCallType = "function call";
-
-const std::string Instruction::functionActionType = "function action";
+void Instruction::createData()
+{
+	switch (type)
+	{
+	case basicBooleanType:
+		booleanValue = false;
+		break;
+	case recursiveFunctionDefinitionType:
+		memoTable = -1;
+		break;
+	case whileStatementType:
+	case countedWhileType:
+		loop = -1;
+		break;
+	case invariantType:
+		cacheEntry = -1;
+		break;
+	case inlineCallType:
+	case inlineArgumentType:
+		argument = -1;
+		break;
+	case functionCallType:
+	case tailCallType:
+		callSite = -1;
+		break;
+	case booleanType:
+	case arithmeticType:
+		operation = 0;
+		break;
+	case numberType:
+		new (&number) Number();
+		break;
+	case variableNameType:
+	case functionNameType:
+		new (&name) std::string();
+		break;
+	default:
+		break;
+	}
+}
 
 void Instruction::deleteData()
 {
-	if (data != nullptr)
-	{
-		if (!basicBooleanType.compare(type)) delete (bool*)(data);
-		else if (!booleanType.compare(type)) delete (char*)(data);
-		else if (!arithmeticType.compare(type)) delete (char*)(data);
-		else if (!numberType.compare(type)) delete (Number*)(data);
-		else if (!variableNameType.compare(type)) delete (std::string*)(data);
-		else if (!functionNameType.compare(type)) delete (std::string*)(data);
+	switch (type)
+	{
+	case numberType:
+		number.~Number();
+		break;
+	case variableNameType:
+	case functionNameType:
+		name.~basic_string();
+		break;
+	default:
+		break;
 	}
 }
 
@@ -37,17 +61,90 @@ void Instruction::copyData(const Instruction& other)
 {
 	type = other.type;
 	parameters = other.parameters;
+	slot = other.slot;
+
+	switch (type)
+	{
+	case basicBooleanType:
+		booleanValue = other.booleanValue;
+		break;
+	case recursiveFunctionDefinitionType:
+		memoTable = other.memoTable;
+		break;
+	case whileStatementType:
+	case countedWhileType:
+		loop = other.loop;
+		break;
+	case invariantType:
+		cacheEntry = other.cacheEntry;
+		break;
+	case inlineCallType:
+	case inlineArgumentType:
+		argument = other.argument;
+		break;
+	case functionCallType:
+	case tailCallType:
+		callSite = other.callSite;
+		break;
+	case booleanType:
+	case arithmeticType:
+		operation = other.operation;
+		break;
+	case numberType:
+		new (&number) Number(other.number);
+		break;
+	case variableNameType:
+	case functionNameType:
+		new (&name) std::string(other.name);
+		break;
+	default:
+		break;
+	}
+}
 
-	if (other.data != nullptr)
-	{
-		if (!basicBooleanType.compare(other.type)) data = new bool(*((bool*)(other.data)));
-		else if (!booleanType.compare(other.type)) data = new char(*((char*)(other.data)));
-		else if (!arithmeticType.compare(other.type)) data = new char(*((char*)(other.data)));
-		else if (!numberType.compare(other.type)) data = new Number(*((Number*)(other.data)));
-		else if (!variableNameType.compare(other.type)) data = new std::string(*((std::string*)(other.data)));
-		else if (!functionNameType.compare(other.type)) data = new std::string(*((std::string*)(other.data)));
+void Instruction::moveData(Instruction& other)
+{
+	type = other.type;
+	parameters = std::move(other.parameters);
+	slot = other.slot;
+
+	switch (type)
+	{
+	case basicBooleanType:
+		booleanValue = other.booleanValue;
+		break;
+	case recursiveFunctionDefinitionType:
+		memoTable = other.memoTable;
+		break;
+	case whileStatementType:
+	case countedWhileType:
+		loop = other.loop;
+		break;
+	case invariantType:
+		cacheEntry = other.cacheEntry;
+		break;
+	case inlineCallType:
+	case inlineArgumentType:
+		argument = other.argument;
+		break;
+	case functionCallType:
+	case tailCallType:
+		callSite = other.callSite;
+		break;
+	case booleanType:
+	case arithmeticType:
+		operation = other.operation;
+		break;
+	case numberType:
+		new (&number) Number(std::move(other.number));
+		break;
+	case variableNameType:
+	case functionNameType:
+		new (&name) std::string(std::move(other.name));
+		break;
+	default:
+		break;
 	}
-	else data = nullptr;
 }
 
 bool Instruction::convertNumber(const std::string& str, Number& num)
@@ -68,23 +165,11 @@ bool Instruction::convertNumber(const std::string& str, Number& num)
 	return 1;
 }
 
-void Instruction::undoRedefining(DEFINITIONS& definitions, REDEFINED& stack, int number)
-{
-	for (int i = 0; i < number; i++)
-	{
-		if (stack.empty()) return;
-		std::string name = stack.top().first;
-
-		definitions[name] = stack.top().second;
-
-		stack.pop();
-	}
-}
-
-Instruction::Instruction(std::string InsType)
+Instruction::Instruction(InstructionType InsType)
 {
 	type = InsType;
-	data = nullptr;
+	slot = -1;
+	createData();
 }
 
 Instruction::Instruction(const Instruction& other)
@@ -92,6 +177,11 @@ Instruction::Instruction(const Instruction& other)
 	copyData(other);
 }
 
+Instruction::Instruction(Instruction&& other) noexcept
+{
+	moveData(other);
+}
+
 Instruction& Instruction::operator=(const Instruction& other)
 {
 	if (this != &other)
@@ -102,6 +192,16 @@ Instruction& Instruction::operator=(const Instruction& other)
 	return *this;
 }
 
+Instruction& Instruction::operator=(Instruction&& other) noexcept
+{
+	if (this != &other)
+	{
+		deleteData();
+		moveData(other);
+	}
+	return *this;
+}
+
 Instruction::~Instruction()
 {
 	deleteData();
@@ -109,16 +209,20 @@ Instruction::~Instruction()
 
 void Instruction::print(std::ostream& outputStream) const
 {
-	if (!defaultType.compare(type)) {}
-	else if (!sequenceType.compare(type))
+	switch (type)
 	{
-		for (int i = 0; i < parameters.size(); i++)
+	case defaultType:
+		break;
+	case sequenceType:
+	{
+		for (size_t i = 0; i < parameters.size(); i++)
 		{
 			parameters[i].print(outputStream);
 			outputStream << '\n';
 		}
+		break;
 	}
-	else if (!ifStatementType.compare(type))
+	case ifStatementType:
 	{
 		outputStream << "if" << '\n';
 		parameters[0].print(outputStream);
@@ -127,33 +231,39 @@ void Instruction::print(std::ostream& outputStream) const
 		outputStream << "else" << '\n';
 		parameters[2].print(outputStream);
 		outputStream << "endif";
+		break;
 	}
-	else if (!whileStatementType.compare(type))
+	case whileStatementType:
+	case countedWhileType:
 	{
 		outputStream << "while" << '\n';
 		parameters[0].print(outputStream);
 		outputStream << '\n';
 		parameters[1].print(outputStream);
 		outputStream << "endwhile";
+		break;
 	}
-	else if (!readType.compare(type))
+	case readType:
 	{
 		outputStream << "read ";
 		parameters[0].print(outputStream);
+		break;
 	}
-	else if (!printType.compare(type))
+	case printType:
 	{
 		outputStream << "print ";
 		parameters[0].print(outputStream);
+		break;
 	}
-	else if (!returnType.compare(type))
+	case returnType:
 	{
 		outputStream << "return ";
 		parameters[0].print(outputStream);
+		break;
 	}
-	else if (!booleanType.compare(type))
+	case booleanType:
 	{
-		if (*((char*)(data)) == '!')
+		if (operation == '!')
 		{
 			outputStream << "!( ";
 			parameters[0].print(outputStream);
@@ -163,7 +273,7 @@ void Instruction::print(std::ostream& outputStream) const
 		{
 			outputStream << "( ";
 			parameters[0].print(outputStream);
-			switch (*((char*)(data)))
+			switch (operation)
 			{
 			case '&':
 				outputStream << " && ";
@@ -184,47 +294,83 @@ void Instruction::print(std::ostream& outputStream) const
 			parameters[1].print(outputStream);
 			outputStream << " )";
 		}
+		break;
 	}
-	else if (!arithmeticType.compare(type))
+	case arithmeticType:
 	{
 		outputStream << "( ";
 		parameters[0].print(outputStream);
-		outputStream << ' ' << *((char*)(data)) << ' ';
+		outputStream << ' ' << operation << ' ';
 		parameters[1].print(outputStream);
 		outputStream << " )";
+		break;
 	}
-	else if (!basicBooleanType.compare(type))
+	case basicBooleanType:
 	{
-		if (*((bool*)(data))) outputStream << "true";
+		if (booleanValue) outputStream << "true";
 		else outputStream << "false";
+		break;
 	}
-	else if (!numberType.compare(type))
+	case numberType:
 	{
-		outputStream << *((Number*)(data));
+		outputStream << number;
+		break;
 	}
-	else if (!variableNameType.compare(type))
+	case variableNameType:
 	{
-		outputStream << *((std::string*)(data));
+		outputStream << name;
+		break;
 	}
-	else if (!functionNameType.compare(type))
+	case functionNameType:
 	{
-		outputStream << *((std::string*)(data));
+		outputStream << name;
+		break;
 	}
-	else if (!variableDefinitionType.compare(type))
+	case variableDefinitionType:
 	{
 		parameters[0].print(outputStream);
 		outputStream << " = ";
 		parameters[1].print(outputStream);
+		break;
+	}
+	case counterStepType:
+	{
+		parameters[0].print(outputStream);
+		outputStream << " = ( ";
+		parameters[0].print(outputStream);
+		outputStream << " + ";
+		parameters[1].print(outputStream);
+		outputStream << " )";
+		break;
+	}
+	case invariantType:
+	{
+		parameters[0].print(outputStream);
+		break;
+	}
+	case inlineCallType:
+	{
+		outputStream << "inline[";
+		parameters[0].print(outputStream);
+		outputStream << "] ";
+		parameters[1].print(outputStream);
+		break;
+	}
+	case inlineArgumentType:
+	{
+		outputStream << "argument " << argument;
+		break;
 	}
-	else if (!functionDefinitionType.compare(type))
+	case functionDefinitionType:
 	{
 		parameters[0].print(outputStream);
 		outputStream << '[';
 		parameters[1].print(outputStream);
 		outputStream << "] = ";
 		parameters[2].print(outputStream);
+		break;
 	}
-	else if (!recursiveFunctionDefinitionType.compare(type))
+	case recursiveFunctionDefinitionType:
 	{
 		outputStream << "recdef" << '\n';
 		parameters[0].print(outputStream);
@@ -233,120 +379,216 @@ void Instruction::print(std::ostream& outputStream) const
 		outputStream << ']' << '\n';
 		parameters[2].print(outputStream);
 		outputStream << "endrecdef";
+		break;
 	}
-	else if (!functionCallType.compare(type))
+	case functionCallType:
+	case tailCallType:
 	{
 		parameters[0].print(outputStream);
 		outputStream << '[';
 		parameters[1].print(outputStream);
 		outputStream << ']';
+		break;
+	}
+	}
+}
+
+bool Instruction::containsCall() const
+{
+	switch (type)
+	{
+	case functionCallType:
+	case tailCallType:
+		return true;
+	case functionDefinitionType:
+	case recursiveFunctionDefinitionType:
+		return false;
+	default:
+		break;
+	}
+
+	for (size_t i = 0; i < parameters.size(); i++)
+	{
+		if (parameters[i].containsCall()) return true;
+	}
+	return false;
+}
+
+bool Instruction::pairsDivision(const Instruction& next) const
+{
+	if (type != variableDefinitionType || next.type != variableDefinitionType) return false;
+	if (parameters[0].slot == next.parameters[0].slot) return false;
+
+	const Instruction& first = parameters[1];
+	const Instruction& second = next.parameters[1];
+	if (first.type != arithmeticType || second.type != arithmeticType) return false;
+	if (!((first.operation == '/' && second.operation == '%') || (first.operation == '%' && second.operation == '/'))) return false;
+
+	for (size_t i = 0; i < 2; i++)
+	{
+		const Instruction& operand = first.parameters[i];
+		const Instruction& other = second.parameters[i];
+		if (operand.type != other.type) return false;
+
+		if (operand.type == numberType)
+		{
+			if (!(operand.number == other.number)) return false;
+		}
+		else if (operand.type == variableNameType)
+		{
+			if (operand.slot != other.slot || operand.slot == parameters[0].slot) return false;
+		}
+		else return false;
+	}
+	return true;
+}
+
+const Instruction* Instruction::resolveCall(char& state, std::string& undefinedObject, Environment& environment) const
+{
+	/// The cached definition is valid while no function binding has changed since it was stored
+	Environment::CallSiteCache& cache = environment.callSites[callSite];
+	if (cache.version == environment.functionVersion) return cache.definition;
+
+	const Binding& binding = environment.lookup(parameters[0].slot);
+	if (binding.kind != Binding::functionBinding)
+	{
+		state = InterpreterErrorFlags::undefinedFunctionFlag;
+		undefinedObject = parameters[0].name;
+		return nullptr;
+	}
+
+	cache.definition = binding.definition;
+	cache.version = environment.functionVersion;
+	return cache.definition;
+}
+
+bool Instruction::testLoopCondition(char& state, std::string& undefinedObject, Environment& environment, std::ostream& os, std::istream& is) const
+{
+	bool ret = false;
+	Number value;
+
+	if (type == whileStatementType)
+	{
+		parameters[0].execute(state, undefinedObject, environment, os, is, ret, value);
+		return state == InterpreterErrorFlags::normalStateFlag && value;
 	}
+
+	/// (i < bound) of a counted loop, compared without copying the counter
+	const Instruction& counter = parameters[0].parameters[0];
+	if (environment.lookup(counter.slot).kind != Binding::numberBinding)
+	{
+		state = InterpreterErrorFlags::undefinedVariableFlag;
+		undefinedObject = counter.name;
+		return false;
+	}
+
+	parameters[0].parameters[1].execute(state, undefinedObject, environment, os, is, ret, value);
+	if (state != InterpreterErrorFlags::normalStateFlag) return false;
+
+	return environment.lookup(counter.slot).number < value;
 }
 
-void Instruction::execute(char& state, std::string& undefinedObject, DEFINITIONS& definitions, DEFINED& alreadyDefined, REDEFINED& redefinedObj, int& redefined, std::ostream& os, std::istream& is, bool& returnFlag, Number& returnValue)
+void Instruction::execute(char& state, std::string& undefinedObject, Environment& environment, std::ostream& os, std::istream& is, bool& returnFlag, Number& returnValue) const
 {
-	if (!defaultType.compare(type)) return;
-	else if (!sequenceType.compare(type))
+	switch (type)
+	{
+	case defaultType:
+		return;
+	case sequenceType:
 	{
-		for (int i = 0; i < parameters.size(); i++)
+		for (size_t i = 0; i < parameters.size(); i++)
 		{
-			parameters[i].execute(state, undefinedObject, definitions, alreadyDefined, redefinedObj, redefined, os, is, returnFlag, returnValue);
+			parameters[i].execute(state, undefinedObject, environment, os, is, returnFlag, returnValue);
 			if (state != InterpreterErrorFlags::normalStateFlag || returnFlag) return;
 		}
+		break;
 	}
-	else if (!ifStatementType.compare(type))
+	case ifStatementType:
 	{
 		Number cond;
 		bool ret = false;
-		parameters[0].execute(state, undefinedObject, definitions, alreadyDefined, redefinedObj, redefined, os, is, ret, cond);
+		parameters[0].execute(state, undefinedObject, environment, os, is, ret, cond);
 		if (state != InterpreterErrorFlags::normalStateFlag) return;
 		if (cond)
 		{
-			parameters[1].execute(state, undefinedObject, definitions, alreadyDefined, redefinedObj, redefined, os, is, returnFlag, returnValue);
+			parameters[1].execute(state, undefinedObject, environment, os, is, returnFlag, returnValue);
 		}
 		else
 		{
-			parameters[2].execute(state, undefinedObject, definitions, alreadyDefined, redefinedObj, redefined, os, is, returnFlag, returnValue);
+			parameters[2].execute(state, undefinedObject, environment, os, is, returnFlag, returnValue);
 		}
+		break;
 	}
-	else if (!whileStatementType.compare(type))
+	case whileStatementType:
+	case countedWhileType:
 	{
-		Number cond;
-		bool ret = false;
-		parameters[0].execute(state, undefinedObject, definitions, alreadyDefined, redefinedObj, redefined, os, is, ret, cond);
+		/// Invariants cached during an earlier run of the loop are outdated now
+		if (loop >= 0) environment.loopEpochs[loop]++;
+
+		bool cond = testLoopCondition(state, undefinedObject, environment, os, is);
 		if (state != InterpreterErrorFlags::normalStateFlag) return;
 		while (cond)
 		{
-			parameters[1].execute(state, undefinedObject, definitions, alreadyDefined, redefinedObj, redefined, os, is, returnFlag, returnValue);
+			parameters[1].execute(state, undefinedObject, environment, os, is, returnFlag, returnValue);
 			if (state != InterpreterErrorFlags::normalStateFlag || returnFlag) return;
-			cond = Number(0);
-			ret = false;
-			parameters[0].execute(state, undefinedObject, definitions, alreadyDefined, redefinedObj, redefined, os, is, ret, cond);
+			cond = testLoopCondition(state, undefinedObject, environment, os, is);
 			if (state != InterpreterErrorFlags::normalStateFlag) return;
 		}
+		break;
 	}
-	else if (!readType.compare(type))
+	case readType:
 	{
 		os << "> ";
 		bool isNumber;
 		Number num;
-		std::string input, name = *((std::string*)(parameters[0].data));
+		std::string input;
 		is >> input;
 		isNumber = convertNumber(input, num);
 		if (isNumber)
 		{
-			Instruction ins(numberType);
-			ins.data = new Number(num);
-			if (alreadyDefined[name])
-			{
-				definitions[name] = ins;
-			}
-			else
-			{
-				redefinedObj.push(make_pair(name, definitions[name]));
-				definitions[name] = ins;
-				alreadyDefined[name] = true;
-				redefined++;
-			}
+			environment.defineNumber(parameters[0].slot, std::move(num));
 		}
 		else
 		{
 			state = InterpreterErrorFlags::invalidInputFlag;
 			return;
 		}
+		break;
 	}
-	else if (!printType.compare(type))
+	case printType:
 	{
 		Number result;
 		bool ret = false;
-		parameters[0].execute(state, undefinedObject, definitions, alreadyDefined, redefinedObj, redefined, os, is, ret, result);
+		parameters[0].execute(state, undefinedObject, environment, os, is, ret, result);
 		if (state != InterpreterErrorFlags::normalStateFlag) return;
 		os << result << '\n';
+		break;
 	}
-	else if (!returnType.compare(type))
+	case returnType:
 	{
 		Number result;
 		bool ret = false;
-		parameters[0].execute(state, undefinedObject, definitions, alreadyDefined, redefinedObj, redefined, os, is, ret, result);
+		parameters[0].execute(state, undefinedObject, environment, os, is, ret, result);
 		if (state != InterpreterErrorFlags::normalStateFlag) return;
 		if (ret)
 		{
 			returnFlag = true;
-			returnValue = result;
+			returnValue = std::move(result);
 		}
 		else
 		{
 			state = InterpreterErrorFlags::lackOfReturnValue;
 			return;
 		}
+		break;
 	}
-	else if (!booleanType.compare(type))
+	case booleanType:
 	{
 		Number first, second;
 		bool ret;
-		char op = *((char*)(data));
+		char op = operation;
 		ret = false;
-		parameters[0].execute(state, undefinedObject, definitions, alreadyDefined, redefinedObj, redefined, os, is, ret, first);
+		parameters[0].execute(state, undefinedObject, environment, os, is, ret, first);
 		if (state != InterpreterErrorFlags::normalStateFlag) return;
 
 		if (op == '!')
@@ -370,7 +612,7 @@ void Instruction::execute(char& state, std::string& undefinedObject, DEFINITIONS
 		}
 
 		ret = false;
-		parameters[1].execute(state, undefinedObject, definitions, alreadyDefined, redefinedObj, redefined, os, is, ret, second);
+		parameters[1].execute(state, undefinedObject, environment, os, is, ret, second);
 		if (state != InterpreterErrorFlags::normalStateFlag) return;
 
 		returnFlag = true;
@@ -397,22 +639,23 @@ void Instruction::execute(char& state, std::string& undefinedObject, DEFINITIONS
 			else returnValue = Number(0);
 			break;
 		}
+		break;
 	}
-	else if (!arithmeticType.compare(type))
+	case arithmeticType:
 	{
 		Number first, second;
 		bool ret;
-		char op = *((char*)(data));
+		char op = operation;
 
 		ret = false;
-		parameters[0].execute(state, undefinedObject, definitions, alreadyDefined, redefinedObj, redefined, os, is, ret, first);
+		parameters[0].execute(state, undefinedObject, environment, os, is, ret, first);
 		if (state != InterpreterErrorFlags::normalStateFlag) return;
 
 		ret = false;
-		parameters[1].execute(state, undefinedObject, definitions, alreadyDefined, redefinedObj, redefined, os, is, ret, second);
+		parameters[1].execute(state, undefinedObject, environment, os, is, ret, second);
 		if (state != InterpreterErrorFlags::normalStateFlag) return;
 
-		if ((op == '/' || op == '%') && second == Number(0))
+		if ((op == '/' || op == '%') && second.isZero())
 		{
 			state = InterpreterErrorFlags::divisionByZeroFlag;
 			return;
@@ -422,13 +665,13 @@ void Instruction::execute(char& state, std::string& undefinedObject, DEFINITIONS
 		switch (op)
 		{
 		case '+':
-			returnValue = first + second;
+			Number::add(first, second, returnValue);
 			break;
 		case '-':
-			returnValue = first - second;
+			Number::subtract(first, second, returnValue);
 			break;
 		case '*':
-			returnValue = first * second;
+			Number::multiply(first, second, returnValue);
 			break;
 		case '/':
 			returnValue = first / second;
@@ -437,150 +680,194 @@ void Instruction::execute(char& state, std::string& undefinedObject, DEFINITIONS
 			returnValue = first % second;
 			break;
 		}
+		break;
 	}
-	else if (!basicBooleanType.compare(type))
+	case basicBooleanType:
 	{
-		bool value = *((bool*)(data));
+		bool value = booleanValue;
 		returnFlag = true;
 		if (value) returnValue = Number(1);
 		else returnValue = Number(0);
+		break;
 	}
-	else if (!numberType.compare(type))
+	case numberType:
 	{
 		returnFlag = true;
-		returnValue = *((Number*)(data));
+		returnValue = number;
+		break;
 	}
-	else if (!variableNameType.compare(type))
+	case variableNameType:
 	{
-		Number result;
-		bool ret;
-		std::string name = *((std::string*)(data));
-		if (!defaultType.compare(definitions[name].type))
+		const Binding& binding = environment.lookup(slot);
+		if (binding.kind != Binding::numberBinding)
 		{
 			state = InterpreterErrorFlags::undefinedVariableFlag;
 			undefinedObject = name;
 			return;
 		}
-		else
-		{
-			ret = false;
-			definitions[name].execute(state, undefinedObject, definitions, alreadyDefined, redefinedObj, redefined, os, is, ret, result);
-			if (state != InterpreterErrorFlags::normalStateFlag) return;
-			returnFlag = true;
-			returnValue = result;
-		}
+		returnFlag = true;
+		returnValue = binding.number;
+		break;
 	}
-	else if (!functionNameType.compare(type)) return;
-	else if (!variableDefinitionType.compare(type))
+	case functionNameType:
+		return;
+	case variableDefinitionType:
 	{
 		Number result;
-		bool ret;
-		std::string variableName = *((std::string*)(parameters[0].data));
-		ret = false;
-		parameters[1].execute(state, undefinedObject, definitions, alreadyDefined, redefinedObj, redefined, os, is, ret, result);
+		bool ret = false;
+		parameters[1].execute(state, undefinedObject, environment, os, is, ret, result);
 		if (state != InterpreterErrorFlags::normalStateFlag) return;
 
-		Instruction ins(numberType);
-		ins.data = new Number(result);
-		if (alreadyDefined[variableName])
+		environment.defineNumber(parameters[0].slot, std::move(result));
+		break;
+	}
+	case counterStepType:
+	{
+		Number* counter = environment.localNumber(parameters[0].slot);
+		if (counter)
 		{
-			definitions[variableName] = ins;
+			*counter += parameters[1].number;
+			break;
 		}
-		else
+
+		const Binding& binding = environment.lookup(parameters[0].slot);
+		if (binding.kind != Binding::numberBinding)
 		{
-			redefinedObj.push(make_pair(variableName, definitions[variableName]));
-			definitions[variableName] = ins;
-			alreadyDefined[variableName] = true;
-			redefined++;
+			state = InterpreterErrorFlags::undefinedVariableFlag;
+			undefinedObject = parameters[0].name;
+			return;
 		}
+		environment.defineNumber(parameters[0].slot, binding.number + parameters[1].number);
+		break;
 	}
-	else if (!functionDefinitionType.compare(type))
+	case invariantType:
 	{
-		Instruction ins(functionActionType);
-		std::string functionName = *((std::string*)(parameters[0].data));
-
-		ins.parameters.push_back(parameters[1]);
-		ins.parameters.push_back(parameters[2]);
+		Environment::InvariantCache& cache = environment.invariantCaches[cacheEntry];
+		unsigned long long epoch = environment.loopEpochs[cache.loop];
 
-		if (alreadyDefined[functionName])
-		{
-			definitions[functionName] = ins;
-		}
-		else
+		if (cache.epoch != epoch)
 		{
-			redefinedObj.push(make_pair(functionName, definitions[functionName]));
-			definitions[functionName] = ins;
-			alreadyDefined[functionName] = true;
-			redefined++;
+			bool ret = false;
+			parameters[0].execute(state, undefinedObject, environment, os, is, ret, cache.value);
+			if (state != InterpreterErrorFlags::normalStateFlag) return;
+			cache.epoch = epoch;
 		}
+		returnFlag = true;
+		returnValue = cache.value;
+		break;
 	}
-	else if (!recursiveFunctionDefinitionType.compare(type))
+	case inlineCallType:
 	{
-		Instruction ins(functionActionType);
-		std::string functionName = *((std::string*)(parameters[0].data));
-
-		
-		ins.parameters.push_back(parameters[1]);
-		ins.parameters.push_back(parameters[2]);
+		/// The argument may run the same call site again, so it is stored only once it is complete
+		Number result;
+		bool ret = false;
+		parameters[0].execute(state, undefinedObject, environment, os, is, ret, result);
+		if (state != InterpreterErrorFlags::normalStateFlag) return;
 
-		if (alreadyDefined[functionName])
-		{
-			definitions[functionName] = ins;
-		}
-		else
-		{
-			redefinedObj.push(make_pair(functionName, definitions[functionName]));
-			definitions[functionName] = ins;
-			alreadyDefined[functionName] = true;
-			redefined++;
-		}
+		environment.inlineArguments[argument] = std::move(result);
+		parameters[1].execute(state, undefinedObject, environment, os, is, returnFlag, returnValue);
+		break;
+	}
+	case inlineArgumentType:
+	{
+		returnFlag = true;
+		returnValue = environment.inlineArguments[argument];
+		break;
 	}
-	else if (!functionCallType.compare(type))
+	case functionDefinitionType:
+	case recursiveFunctionDefinitionType:
+	{
+		environment.defineFunction(parameters[0].slot, this);
+		break;
+	}
+	case functionCallType:
 	{
 		Number result;
 		bool ret;
-		std::string variableName, functionName = *((std::string*)(parameters[0].data));
 
-		if (!defaultType.compare(definitions[functionName].type))
-		{
-			state = InterpreterErrorFlags::undefinedFunctionFlag;
-			undefinedObject = functionName;
-			return;
-		}
+		const Instruction* definition = resolveCall(state, undefinedObject, environment);
+		if (!definition) return;
 		else
 		{
+			/// Calls in the argument leave the function bindings as they found them
 			ret = false;
-			parameters[1].execute(state, undefinedObject, definitions, alreadyDefined, redefinedObj, redefined, os, is, ret, result);
+			parameters[1].execute(state, undefinedObject, environment, os, is, ret, result);
 			if (state != InterpreterErrorFlags::normalStateFlag) return;
 
-			Instruction ins(numberType);
-			ins.data = new Number(result);
+			const Instruction* call = this;
+			const Instruction& called = *definition;
+			MemoCache* memo = nullptr;
+			Number argument;
 
-			int newRedefined = 0;
-			DEFINED newAlreadyDefined;
-			variableName = *((std::string*)(definitions[functionName].parameters[0].data));
-			redefinedObj.push(make_pair(variableName, definitions[variableName]));
-			definitions[variableName] = ins;
-			newAlreadyDefined[variableName] = true;
-			newRedefined++;
+			if (called.type == recursiveFunctionDefinitionType && called.memoTable >= 0)
+			{
+				memo = &environment.memoCaches[called.memoTable];
+				const Number* cached = memo->find(result);
+				if (cached)
+				{
+					returnFlag = true;
+					returnValue = *cached;
+					return;
+				}
+				argument = result;
+			}
 
-			ret = false;
-			definitions[functionName].parameters[1].execute(state, undefinedObject, definitions, newAlreadyDefined, redefinedObj, newRedefined, os, is, ret, result);
-			undoRedefining(definitions, redefinedObj, newRedefined);
+			/// The frames of this engine are on the native stack, so their number is limited
+			if (environment.depth() > environment.callLimit)
+			{
+				state = InterpreterErrorFlags::recursionLimitFlag;
+				return;
+			}
+			environment.pushFrame();
+
+			/// Tail calls of the body continue here in the same frame. The frame of the
+			/// caller would be left right after them, so its bindings may be overwritten.
+			do
+			{
+				environment.defineNumber(definition->parameters[1].slot, std::move(result));
+
+				ret = false;
+				environment.tailCall = nullptr;
+				definition->parameters[2].execute(state, undefinedObject, environment, os, is, ret, result);
+				if (environment.tailCall)
+				{
+					/// Still cached from the check the tail call has just made
+					call = environment.tailCall;
+					definition = call->resolveCall(state, undefinedObject, environment);
+				}
+			}
+			while (state == InterpreterErrorFlags::normalStateFlag && environment.tailCall);
+
+			environment.popFrame();
 			if (state != InterpreterErrorFlags::normalStateFlag) return;
 
 			if (ret)
 			{
+				if (memo) memo->insert(argument, result);
 				returnFlag = true;
-				returnValue = result;
+				returnValue = std::move(result);
 			}
 			else
 			{
 				state = InterpreterErrorFlags::lackOfReturnValue;
-				undefinedObject = functionName;
+				undefinedObject = call->parameters[0].name;
 				return;
 			}
 		}
+		break;
+	}
+	case tailCallType:
+	{
+		if (!resolveCall(state, undefinedObject, environment)) return;
+
+		/// The argument is handed back as the return value, the enclosing call runs the function
+		bool ret = false;
+		parameters[1].execute(state, undefinedObject, environment, os, is, ret, returnValue);
+		if (state != InterpreterErrorFlags::normalStateFlag) return;
+
+		returnFlag = true;
+		environment.tailCall = this;
+		break;
+	}
 	}
-	else if (!functionActionType.compare(type)) return;
 }
\ No newline at end of file
@@ -1,13 +1,14 @@
 #pragma once
 
-#include <stack>
 #include <vector>
 #include <string>
 #include <map>
 #include <cstring>
 #include <iostream>
+#include <utility>
 
 #include "Number.h"
+#include "Environment.h"
 #include "Interpreter Error Flags.h"
 
 struct StringCompare {
@@ -17,57 +18,97 @@ struct StringCompare {
 	}
 };
 
-class Instruction;
-
-using DEFINITIONS = std::map<std::string, Instruction, StringCompare>;
-using DEFINED = std::map<std::string, bool, StringCompare>;
-using REDEFINED = std::stack<std::pair<std::string, Instruction>>;
-
 class Interpreter;
 
 class Instruction
 {
 private:
-	/// General types:
-	const static std::string defaultType;
-	const static std::string sequenceType;
-	const static std::string ifStatementType;
-	const static std::string whileStatementType;
-	const static std::string readType;
-	const static std::string printType;
-	const static std::string returnType;
-	const static std::string booleanType;						/// Has char data
-	const static std::string arithmeticType;					/// Has char data
-	const static std::string basicBooleanType;					/// Has bool data
-	const static std::string numberType;						/// Has Number data
-	const static std::string variableNameType;					/// Has string data
-	const static std::string functionNameType;					/// Has string data
-	const static std::string variableDefinitionType;
-	const static std::string functionDefinitionType;
-	const static std::string recursiveFunctionDefinitionType;
-	const static std::string functionCallType;
+	enum InstructionType : unsigned char
+	{
+		/// General types:
+		defaultType,
+		sequenceType,
+		ifStatementType,
+		whileStatementType,						/// Has loop data
+		readType,
+		printType,
+		returnType,
+		booleanType,							/// Has char data
+		arithmeticType,							/// Has char data
+		basicBooleanType,						/// Has bool data
+		numberType,								/// Has Number data
+		variableNameType,						/// Has string data
+		functionNameType,						/// Has string data
+		variableDefinitionType,
+		functionDefinitionType,
+		recursiveFunctionDefinitionType,		/// Has memo table data
+		functionCallType,						/// Has call site data
+		tailCallType,							/// A function call returned directly by a recdef, has call site data
 
-	/// Runtime types:
-	const static std::string functionActionType;
+		/// Loop optimizer types:
+		countedWhileType,						/// A while (i < bound) stepping i by a literal, has loop data
+		counterStepType,						/// The i = i + c of a counted while
+		invariantType,							/// An expression that does not change during its loop, has cache data
 
-	std::string type;
+		/// Inliner types:
+		inlineCallType,							/// A call replaced by the body of its function, has argument data
+		inlineArgumentType						/// The parameter inside an inlined body, has argument data
+	};
+
+	InstructionType type;
 	std::vector<Instruction> parameters;
-	void* data;
+	union
+	{
+		bool booleanValue;
+		char operation;
+		Number number;
+		std::string name;
+		/// Index of the MemoCache of a pure recdef, -1 if its calls are not memoized
+		int memoTable;
+		/// Index of the epoch of a loop that caches invariants, -1 for none
+		int loop;
+		/// Index of the cache of an invariant in Environment
+		int cacheEntry;
+		/// Index of the argument of an inlined call in Environment
+		int argument;
+		/// Index of the inline cache of a call in Environment
+		int callSite;
+	};
+	/// Environment slot of a variable or function name, assigned by the parser
+	int slot;
 
+	void createData();
 	void deleteData();
 	void copyData(const Instruction&);
+	void moveData(Instruction&);
 
 	static bool convertNumber(const std::string&, Number&);
-	static void undoRedefining(DEFINITIONS&, REDEFINED&, int);
+
+	/// Whether a function call is evaluated anywhere in this instruction, bodies of definitions excluded
+	bool containsCall() const;
+	/// Whether this definition and the next statement define a quotient and a remainder of the same
+	/// operands, so one division gives both. The operands are read once, before either is stored.
+	bool pairsDivision(const Instruction& next) const;
+	const Instruction* resolveCall(char& state, std::string& undefinedObject, Environment& environment) const;
+	bool testLoopCondition(char& state, std::string& undefinedObject, Environment& environment, std::ostream& os, std::istream& is) const;
 
 public:
-	Instruction(std::string = defaultType);
+	Instruction(InstructionType = defaultType);
 	Instruction(const Instruction&);
+	Instruction(Instruction&&) noexcept;
 	Instruction& operator=(const Instruction&);
+	Instruction& operator=(Instruction&&) noexcept;
 	~Instruction();
 
 	void print(std::ostream& outputStream = std::cout) const;
-	void execute(char& state, std::string& undefinedObject, DEFINITIONS& definitions, DEFINED& alreadyDefined, REDEFINED& redefinedObj, int& redefined, std::ostream& os, std::istream& is, bool& returnFlag, Number& returnValue);
+	void execute(char& state, std::string& undefinedObject, Environment& environment, std::ostream& os, std::istream& is, bool& returnFlag, Number& returnValue) const;
 
 	friend class Interpreter;
+	friend class BytecodeCompiler;
+	friend class VirtualMachine;
+	friend class Optimizer;
+	friend class LoopOptimizer;
+	friend class Inliner;
+	friend class CompiledRuntime;
+	friend class CppGenerator;
 };
\ No newline at end of file
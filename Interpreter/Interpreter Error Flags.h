@@ -27,6 +27,7 @@ struct InterpreterErrorFlags
 	const static char undefinedVariableFlag = 32;
 	const static char undefinedFunctionFlag = 33;
 	const static char lackOfReturnValue = 34;
+	const static char recursionLimitFlag = 35;
 
 
 	InterpreterErrorFlags() = delete;
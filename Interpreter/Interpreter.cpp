@@ -1,4 +1,16 @@
 #include "Interpreter.h"
+#include "BytecodeCompiler.h"
+#include "VirtualMachine.h"
+#include "Optimizer.h"
+#include "LoopOptimizer.h"
+#include "Inliner.h"
+#include "CppGenerator.h"
+
+/// Default call limits, a call of the tree walker takes a few kilobytes of native stack
+static const size_t treeWalkingRecursionLimit = 2000;
+static const size_t bytecodeRecursionLimit = 1000000;
+/// Calls and loop iterations after which the virtual machine compiles a function
+static const unsigned int defaultJitThreshold = 100;
 
 void Interpreter::removeSpaces(const std::string& s, int& beginIndex, int& endIndex)
 {
@@ -6,6 +18,37 @@ void Interpreter::removeSpaces(const std::string& s, int& beginIndex, int& endIn
 	while (endIndex > beginIndex && s[endIndex] == ' ') endIndex--;
 }
 
+bool Interpreter::isPure(const Instruction& Ins, int parameterSlot, int functionSlot)
+{
+	/// Names are scoped dynamically, so only the parameter and calls of the function
+	/// itself are known to mean the same thing on every call.
+	switch (Ins.type)
+	{
+	case Instruction::readType:
+	case Instruction::printType:
+	case Instruction::functionDefinitionType:
+	case Instruction::recursiveFunctionDefinitionType:
+		return false;
+	case Instruction::variableNameType:
+		return Ins.slot == parameterSlot;
+	case Instruction::variableDefinitionType:
+		if (Ins.parameters[0].slot != parameterSlot) return false;
+		return isPure(Ins.parameters[1], parameterSlot, functionSlot);
+	case Instruction::functionCallType:
+	case Instruction::tailCallType:
+		if (Ins.parameters[0].slot != functionSlot) return false;
+		return isPure(Ins.parameters[1], parameterSlot, functionSlot);
+	default:
+		break;
+	}
+
+	for (size_t i = 0; i < Ins.parameters.size(); i++)
+	{
+		if (!isPure(Ins.parameters[i], parameterSlot, functionSlot)) return false;
+	}
+	return true;
+}
+
 void Interpreter::handleLackOfEndLine(const std::string& expectedEndLine)
 {
 	if (!expectedEndLine.compare("else"))
@@ -80,36 +123,51 @@ void Interpreter::handleErrorFlag(std::ostream& outputStream)
 	case InterpreterErrorFlags::lackOfReturnValue:
 		outputStream << "Function " << undefinedObjectName << " failed to return a value!\n";
 		break;
+	case InterpreterErrorFlags::recursionLimitFlag:
+		outputStream << "The program made more than " << recursionLimit << " nested calls!\n";
+		break;
 	}
 
 	stateFlag = InterpreterErrorFlags::alreadyRunFlag;
 }
 
-void Interpreter::checkSequence(Instruction& Ins, bool possibleReturn, const std::string& expectedEndLine)
+int Interpreter::resolveSlot(const std::string& name)
 {
-	if (file.eof())
-	{
-		if (expectedEndLine.compare("")) handleLackOfEndLine(expectedEndLine);
-		return;
-	}
+	std::map<std::string, int, StringCompare>::iterator it = slots.find(name);
+	if (it != slots.end()) return it->second;
+
+	int slot = slotNames.size();
+	slots[name] = slot;
+	slotNames.push_back(name);
+	return slot;
+}
 
+void Interpreter::checkSequence(Instruction& Ins, bool possibleReturn, const std::string& expectedEndLine)
+{
 	int beginIndex, endIndex;
 	std::string line;
 
-	currentLine++;
-	getline(file, line);
-	beginIndex = 0;
-	endIndex = line.length() - 1;
-	removeSpaces(line, beginIndex, endIndex);
+	/// One line per iteration, only nested blocks recurse
+	while (stateFlag == InterpreterErrorFlags::normalStateFlag)
+	{
+		if (file.eof())
+		{
+			if (expectedEndLine.compare("")) handleLackOfEndLine(expectedEndLine);
+			return;
+		}
 
-	if (!std::string("if").compare(line.substr(beginIndex, endIndex - beginIndex + 1))) Ins.parameters.push_back(checkIf(possibleReturn));
-	else if (!std::string("while").compare(line.substr(beginIndex, endIndex - beginIndex + 1))) Ins.parameters.push_back(checkWhile(possibleReturn));
-	else if (!std::string("recdef").compare(line.substr(beginIndex, endIndex - beginIndex + 1))) Ins.parameters.push_back(checkRecdef());
-	else if (expectedEndLine.compare("") && !expectedEndLine.compare(line.substr(beginIndex, endIndex - beginIndex + 1))) return;
-	else Ins.parameters.push_back(checkLine(possibleReturn, line, beginIndex, endIndex));
+		currentLine++;
+		getline(file, line);
+		beginIndex = 0;
+		endIndex = line.length() - 1;
+		removeSpaces(line, beginIndex, endIndex);
 
-	if (stateFlag != InterpreterErrorFlags::normalStateFlag) return;
-	checkSequence(Ins, possibleReturn, expectedEndLine);
+		if (!std::string("if").compare(line.substr(beginIndex, endIndex - beginIndex + 1))) Ins.parameters.push_back(checkIf(possibleReturn));
+		else if (!std::string("while").compare(line.substr(beginIndex, endIndex - beginIndex + 1))) Ins.parameters.push_back(checkWhile(possibleReturn));
+		else if (!std::string("recdef").compare(line.substr(beginIndex, endIndex - beginIndex + 1))) Ins.parameters.push_back(checkRecdef());
+		else if (expectedEndLine.compare("") && !expectedEndLine.compare(line.substr(beginIndex, endIndex - beginIndex + 1))) return;
+		else Ins.parameters.push_back(checkLine(possibleReturn, line, beginIndex, endIndex));
+	}
 }
 
 Instruction Interpreter::checkIf(bool possibleReturn)
@@ -155,11 +213,11 @@ Instruction Interpreter::checkIf(bool possibleReturn)
 	Instruction trueSequence(Instruction::sequenceType), falseSequence(Instruction::sequenceType);
 
 	checkSequence(trueSequence, possibleReturn, std::string("else"));
-	temp.parameters.push_back(trueSequence);
+	temp.parameters.push_back(std::move(trueSequence));
 	if (stateFlag != InterpreterErrorFlags::normalStateFlag) return temp;
 
 	checkSequence(falseSequence, possibleReturn, std::string("endif"));
-	temp.parameters.push_back(falseSequence);
+	temp.parameters.push_back(std::move(falseSequence));
 
 	return temp;
 }
@@ -188,7 +246,7 @@ Instruction Interpreter::checkWhile(bool possibleReturn)
 
 	Instruction sequence(Instruction::sequenceType);
 	checkSequence(sequence, possibleReturn, std::string("endwhile"));
-	temp.parameters.push_back(sequence);
+	temp.parameters.push_back(std::move(sequence));
 
 	return temp;
 }
@@ -232,7 +290,12 @@ Instruction Interpreter::checkRecdef()
 	Instruction sequence(Instruction::sequenceType);
 
 	checkSequence(sequence, true, std::string("endrecdef"));
-	temp.parameters.push_back(sequence);
+	temp.parameters.push_back(std::move(sequence));
+
+	if (memoization && stateFlag == InterpreterErrorFlags::normalStateFlag && isPure(temp.parameters[2], temp.parameters[1].slot, temp.parameters[0].slot))
+	{
+		temp.memoTable = memoTables++;
+	}
 
 	return temp;
 }
@@ -277,6 +340,9 @@ Instruction Interpreter::checkLine(bool possibleReturn, const std::string& line,
 		newEndInd = endIndex;
 		removeSpaces(line, newBegInd, newEndInd);
 		temp.parameters.push_back(checkExpr(line, newBegInd, newEndInd));
+
+		/// Nothing is left to do after a returned call, so it may reuse the frame of the caller
+		if (temp.parameters[0].type == Instruction::functionCallType) temp.parameters[0].type = Instruction::tailCallType;
 		return temp;
 	}
 
@@ -301,7 +367,7 @@ Instruction Interpreter::checkLine(bool possibleReturn, const std::string& line,
 	if (stateFlag == InterpreterErrorFlags::normalStateFlag)
 	{
 		temp = Instruction(Instruction::variableDefinitionType);
-		temp.parameters.push_back(arg);
+		temp.parameters.push_back(std::move(arg));
 	}
 	else
 	{
@@ -354,20 +420,20 @@ Instruction Interpreter::checkCond(const std::string& line, int beginIndex, int
 	if (!std::string("true").compare(line.substr(beginIndex, endIndex - beginIndex + 1)))
 	{
 		temp = Instruction(Instruction::basicBooleanType);
-		temp.data = new bool(true);
+		temp.booleanValue = true;
 		return temp;
 	}
 	if (!std::string("false").compare(line.substr(beginIndex, endIndex - beginIndex + 1)))
 	{
 		temp = Instruction(Instruction::basicBooleanType);
-		temp.data = new bool(false);
+		temp.booleanValue = false;
 		return temp;
 	}
 
 	if (line[beginIndex] == '!' && line[endIndex] == ')' && line[beginIndex + 1] == '(')
 	{
 		temp = Instruction(Instruction::booleanType);
-		temp.data = new char('!');
+		temp.operation = '!';
 		newBegInd = beginIndex + 2;
 		newEndInd = endIndex - 1;
 		removeSpaces(line, newBegInd, newEndInd);
@@ -396,7 +462,7 @@ Instruction Interpreter::checkCond(const std::string& line, int beginIndex, int
 			stateFlag = InterpreterErrorFlags::invalidLineFlag;
 			return temp;
 		}
-		temp.data = new char(line[operationIndex]);
+		temp.operation = line[operationIndex];
 
 		if (line[operationIndex] == '<' || line[operationIndex] == '>' || line[operationIndex] == '=')
 		{
@@ -469,7 +535,7 @@ Instruction Interpreter::checkExpr(const std::string& line, int beginIndex, int
 
 	if (operationIndex < beginIndex) return checkTerm(line, beginIndex, endIndex);
 
-	temp.data = new char(line[operationIndex]);
+	temp.operation = line[operationIndex];
 
 	newBegInd = beginIndex;
 	newEndInd = operationIndex - 1;
@@ -510,7 +576,7 @@ Instruction Interpreter::checkTerm(const std::string& line, int beginIndex, int
 		return checkFactor(line, beginIndex, endIndex);
 	}
 
-	temp.data = new char(line[operationIndex]);
+	temp.operation = line[operationIndex];
 
 	newBegInd = beginIndex;
 	newEndInd = operationIndex - 1;
@@ -551,6 +617,7 @@ Instruction Interpreter::checkFactor(const std::string& line, int beginIndex, in
 	if (line[endIndex] == ']')
 	{
 		temp = Instruction(Instruction::functionCallType);
+		temp.callSite = callSites++;
 
 		for (leftBracket = beginIndex; leftBracket <= endIndex; leftBracket++)
 		{
@@ -601,7 +668,8 @@ Instruction Interpreter::checkFun(const std::string& line, int beginIndex, int e
 	}
 
 	Instruction temp = Instruction(Instruction::functionNameType);
-	temp.data = new std::string(line.substr(beginIndex, endIndex - beginIndex + 1));
+	temp.name = line.substr(beginIndex, endIndex - beginIndex + 1);
+	temp.slot = resolveSlot(temp.name);
 	return temp;
 }
 
@@ -621,7 +689,8 @@ Instruction Interpreter::checkVar(const std::string& line, int beginIndex, int e
 	}
 
 	Instruction temp = Instruction(Instruction::variableNameType);
-	temp.data = new std::string(line.substr(beginIndex, endIndex - beginIndex + 1));
+	temp.name = line.substr(beginIndex, endIndex - beginIndex + 1);
+	temp.slot = resolveSlot(temp.name);
 	return temp;
 }
 
@@ -641,7 +710,7 @@ Instruction Interpreter::checkNum(const std::string& line, int beginIndex, int e
 	}
 
 	Instruction temp = Instruction(Instruction::numberType);
-	temp.data = new Number(line.substr(beginIndex, endIndex - beginIndex + 1));
+	temp.number = Number(line.substr(beginIndex, endIndex - beginIndex + 1));
 	return temp;
 }
 
@@ -649,6 +718,14 @@ Interpreter::Interpreter()
 {
 	address = nullptr;
 	stateFlag = InterpreterErrorFlags::normalStateFlag;
+	engine = bytecodeEngine;
+	optimization = true;
+	memoization = true;
+	memoTables = 0;
+	callSites = 0;
+	recursionLimit = 0;
+	jitThreshold = defaultJitThreshold;
+	memoStatistics = MemoCache::Statistics();
 	currentLine = 0;
 	mainSequence = Instruction(Instruction::sequenceType);
 }
@@ -658,12 +735,42 @@ Interpreter::~Interpreter()
 	if (address != nullptr) delete address;
 }
 
-void Interpreter::run(const std::string& fileAddress, std::istream& inputStream, std::ostream& outputStream)
+void Interpreter::setExecutionEngine(ExecutionEngine executionEngine)
+{
+	engine = executionEngine;
+}
+
+void Interpreter::setOptimization(bool enabled)
+{
+	optimization = enabled;
+}
+
+void Interpreter::setMemoization(bool enabled)
+{
+	memoization = enabled;
+}
+
+void Interpreter::setRecursionLimit(size_t limit)
+{
+	recursionLimit = limit;
+}
+
+void Interpreter::setJitThreshold(unsigned int threshold)
+{
+	jitThreshold = threshold;
+}
+
+MemoCache::Statistics Interpreter::memoizationStatistics() const
+{
+	return memoStatistics;
+}
+
+bool Interpreter::parse(const std::string& fileAddress, std::ostream& outputStream)
 {
 	if (stateFlag != InterpreterErrorFlags::normalStateFlag)
 	{
 		handleErrorFlag(outputStream);
-		return;
+		return false;
 	}
 
 	if (address != nullptr) delete address;
@@ -676,7 +783,7 @@ void Interpreter::run(const std::string& fileAddress, std::istream& inputStream,
 	{
 		stateFlag = InterpreterErrorFlags::invalidAddressFlag;
 		handleErrorFlag(outputStream);
-		return;
+		return false;
 	}
 
 	currentLine = 0;
@@ -686,17 +793,77 @@ void Interpreter::run(const std::string& fileAddress, std::istream& inputStream,
 	if (stateFlag != InterpreterErrorFlags::normalStateFlag)
 	{
 		handleErrorFlag(outputStream);
-		return;
+		return false;
 	}
+	return true;
+}
+
+void Interpreter::optimize(int& inlineArguments, int& loops, std::vector<int>& invariantLoops)
+{
+	if (!optimization) return;
+
+	Inliner::optimize(mainSequence, inlineArguments);
+	Optimizer::optimize(mainSequence);
+	LoopOptimizer::optimize(mainSequence, loops, invariantLoops);
+}
 
-	DEFINITIONS definitions;
-	DEFINED alreadyDefined;
-	REDEFINED predefinedObjects;
-	int redefined = 0;
-	bool ret = false;
-	Number result;
+void Interpreter::run(const std::string& fileAddress, std::istream& inputStream, std::ostream& outputStream)
+{
+	if (!parse(fileAddress, outputStream)) return;
+
+	int inlineArguments = 0;
+	int loops = 0;
+	std::vector<int> invariantLoops;
+	optimize(inlineArguments, loops, invariantLoops);
+
+	Environment environment(slotNames.size());
+	environment.memoCaches.resize(memoTables);
+	environment.inlineArguments.resize(inlineArguments);
+	environment.callSites.assign(callSites, Environment::CallSiteCache());
+	if (recursionLimit == 0) recursionLimit = (engine == bytecodeEngine ? bytecodeRecursionLimit : treeWalkingRecursionLimit);
+	environment.callLimit = recursionLimit;
+	environment.loopEpochs.assign(loops, 0);
+	environment.invariantCaches.resize(invariantLoops.size());
+	for (size_t i = 0; i < invariantLoops.size(); i++)
+	{
+		environment.invariantCaches[i].epoch = 0;
+		environment.invariantCaches[i].loop = invariantLoops[i];
+	}
+
+	if (engine == bytecodeEngine)
+	{
+		VirtualMachine machine(jitThreshold);
+		machine.run(BytecodeCompiler::compile(mainSequence, slotNames), environment, stateFlag, undefinedObjectName, outputStream, inputStream);
+	}
+	else
+	{
+		bool ret = false;
+		Number result;
+
+		environment.pushFrame();
+		mainSequence.execute(stateFlag, undefinedObjectName, environment, outputStream, inputStream, ret, result);
+		environment.popFrame();
+	}
+
+	for (size_t i = 0; i < environment.memoCaches.size(); i++)
+	{
+		MemoCache::Statistics statistics = environment.memoCaches[i].statistics();
+		memoStatistics.hits += statistics.hits;
+		memoStatistics.misses += statistics.misses;
+		memoStatistics.entries += statistics.entries;
+	}
 
-	mainSequence.execute(stateFlag, undefinedObjectName, definitions, alreadyDefined, predefinedObjects, redefined, outputStream, inputStream, ret, result);
-	Instruction::undoRedefining(definitions, predefinedObjects, redefined);
 	handleErrorFlag(outputStream);
+}
+
+void Interpreter::translate(const std::string& fileAddress, std::ostream& source, std::ostream& outputStream)
+{
+	if (!parse(fileAddress, outputStream)) return;
+
+	int inlineArguments = 0;
+	int loops = 0;
+	std::vector<int> invariantLoops;
+	optimize(inlineArguments, loops, invariantLoops);
+
+	CppGenerator::generate(mainSequence, slotNames, invariantLoops, source);
 }
\ No newline at end of file
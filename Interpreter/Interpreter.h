@@ -7,21 +7,46 @@
 #include "Instruction.h"
 #include "Interpreter Error Flags.h"
 
+enum ExecutionEngine : unsigned char
+{
+	/// Executes the parsed instructions directly, the reference implementation
+	treeWalkingEngine,
+	/// Compiles the program to bytecode and runs it on VirtualMachine, the default; its
+	/// calls are kept on the heap, so deep recursion does not overflow the native stack
+	bytecodeEngine
+};
+
 class Interpreter
 {
 private:
 	char* address;
 	char stateFlag;
+	ExecutionEngine engine;
+	bool optimization;
+	bool memoization;
+	int memoTables;
+	int callSites;
+	size_t recursionLimit;
+	unsigned int jitThreshold;
+	MemoCache::Statistics memoStatistics;
 	int currentLine;
 	std::string undefinedObjectName;
 	std::ifstream file;
 
 	Instruction mainSequence;
+	/// Identifiers of the program and the environment slots assigned to them
+	std::map<std::string, int, StringCompare> slots;
+	std::vector<std::string> slotNames;
 	
 	static void removeSpaces(const std::string&, int&, int&);
+	static bool isPure(const Instruction&, int parameterSlot, int functionSlot);
 
 	void handleLackOfEndLine(const std::string&);
 	void handleErrorFlag(std::ostream&);
+	int resolveSlot(const std::string&);
+	bool parse(const std::string&, std::ostream&);
+	/// The passes run on the parsed program, by the engines and by translate alike
+	void optimize(int& inlineArguments, int& loops, std::vector<int>& invariantLoops);
 
 	void checkSequence(Instruction&, bool possibleReturn = false, const std::string& expectedEndLine = "");
 	Instruction checkIf(bool possibleReturn);
@@ -39,7 +64,23 @@ public:
 	Interpreter();
 	~Interpreter();
 
+	void setExecutionEngine(ExecutionEngine);
+	/// Constant folding and removal of unreachable code before running (on by default)
+	void setOptimization(bool);
+	/// Calls of recdef functions that depend only on their argument are cached (on by default)
+	void setMemoization(bool);
+	/// Most calls a program may have open at once, 0 for the default of the engine. The
+	/// tree walker keeps its calls on the native stack, so its default is much lower.
+	void setRecursionLimit(size_t);
+	/// Calls and loop iterations after which the virtual machine compiles a function to
+	/// x86-64 machine code, 0 turns the compiler off; it is off on other processors
+	void setJitThreshold(unsigned int);
+	/// Counters of the memo caches, summed over the functions of the last program run
+	MemoCache::Statistics memoizationStatistics() const;
+
 	void run(const std::string&, std::istream& = std::cin, std::ostream& = std::cout);
+	/// Writes the program as C++ source for CompiledRuntime, errors go to the last stream
+	void translate(const std::string&, std::ostream& source, std::ostream& = std::cout);
 
 	friend class Instruction;
 };
\ No newline at end of file
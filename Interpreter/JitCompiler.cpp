@@ -0,0 +1,1002 @@
+#include "JitCompiler.h"
+#include "VirtualMachine.h"
+#include "Instruction.h"
+#include "Interpreter Error Flags.h"
+
+#include <cstddef>
+#include <cstring>
+#include <utility>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define JIT_X64
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#endif
+
+/// Signature of the entry of the code: the machine and the address to continue at
+typedef size_t (*JitEntry)(VirtualMachine*, const unsigned char*);
+
+const size_t JitCode::noEntry;
+
+JitCode::JitCode()
+{
+	memory = nullptr;
+	size = 0;
+}
+
+JitCode::JitCode(JitCode&& other) noexcept : entries(std::move(other.entries))
+{
+	memory = other.memory;
+	size = other.size;
+	other.memory = nullptr;
+	other.size = 0;
+}
+
+JitCode& JitCode::operator=(JitCode&& other) noexcept
+{
+	if (this != &other)
+	{
+		release();
+		memory = other.memory;
+		size = other.size;
+		entries = std::move(other.entries);
+		other.memory = nullptr;
+		other.size = 0;
+	}
+	return *this;
+}
+
+JitCode::~JitCode()
+{
+	release();
+}
+
+void JitCode::release()
+{
+	if (memory == nullptr) return;
+
+#if defined(JIT_X64) && defined(_WIN32)
+	VirtualFree(memory, 0, MEM_RELEASE);
+#elif defined(JIT_X64)
+	munmap(memory, size);
+#endif
+	memory = nullptr;
+	size = 0;
+}
+
+bool JitCode::isCompiled() const
+{
+	return memory != nullptr;
+}
+
+size_t JitCode::run(VirtualMachine& machine, size_t pc) const
+{
+	if (entries[pc] == noEntry) return pc;
+
+	JitEntry entry = reinterpret_cast<JitEntry>(memory);
+	return entry(&machine, memory + entries[pc]);
+}
+
+JitCompiler::JitCompiler(const VirtualMachine& machine, const BytecodeFunction& function) : machine(machine), function(function)
+{
+}
+
+void JitCompiler::findTargets()
+{
+	const std::vector<BytecodeInstruction>& instructions = function.code;
+	targets.assign(instructions.size() + 2, false);
+	targets[0] = true;
+
+	for (size_t i = 0; i < instructions.size(); i++)
+	{
+		switch (instructions[i].opcode)
+		{
+		case jumpOpcode:
+		case jumpIfFalseOpcode:
+		case jumpIfTrueOpcode:
+			targets[instructions[i].operand] = true;
+			break;
+		case loadInvariantOpcode:
+			targets[i + 2] = true;
+			break;
+		case readVariableOpcode:
+		case defineFunctionOpcode:
+		case callOpcode:
+		case tailCallOpcode:
+		case returnOpcode:
+			/// The machine enters the code again right after these
+			targets[i + 1] = true;
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+bool JitCompiler::fusable(size_t index, Opcode second) const
+{
+	return index + 1 < function.code.size() && function.code[index + 1].opcode == second && !targets[index + 1];
+}
+
+bool JitCompiler::fusableBranch(size_t index) const
+{
+	/// An operand, a comparison and a jump testing it
+	if (index + 2 >= function.code.size() || targets[index + 1] || targets[index + 2]) return false;
+
+	Opcode comparison = function.code[index + 1].opcode;
+	Opcode jump = function.code[index + 2].opcode;
+	return comparison >= lessOpcode && comparison <= equalOpcode && (jump == jumpIfFalseOpcode || jump == jumpIfTrueOpcode);
+}
+
+void JitCompiler::emitByte(unsigned char byte)
+{
+	code.push_back(byte);
+}
+
+void JitCompiler::emitInt(unsigned int value)
+{
+	for (int i = 0; i < 4; i++) emitByte((value >> (8 * i)) & 0xFF);
+}
+
+void JitCompiler::emitCall(Helper helper, int operand)
+{
+	/// The machine is kept in rbx, the operand goes in the second argument register
+#if defined(_WIN32)
+	emitByte(0x48); emitByte(0x89); emitByte(0xD9);		/// mov rcx, rbx
+	emitByte(0xBA);										/// mov edx, operand
+#else
+	emitByte(0x48); emitByte(0x89); emitByte(0xDF);		/// mov rdi, rbx
+	emitByte(0xBE);										/// mov esi, operand
+#endif
+	emitInt(operand);
+
+	unsigned long long address = reinterpret_cast<unsigned long long>(helper);
+	emitByte(0x48); emitByte(0xB8);						/// mov rax, helper
+	emitInt(address & 0xFFFFFFFF);
+	emitInt(address >> 32);
+	emitByte(0xFF); emitByte(0xD0);						/// call rax
+}
+
+void JitCompiler::emitJump(unsigned char condition, int target)
+{
+	/// condition is the second byte of a jcc rel32, 0 for an unconditional jump
+	if (condition)
+	{
+		emitByte(0x85); emitByte(0xC0);					/// test eax, eax
+	}
+	emitFlagJump(condition, target);
+}
+
+void JitCompiler::emitFlagJump(unsigned char condition, int target)
+{
+	if (condition)
+	{
+		emitByte(0x0F);
+		emitByte(condition);
+	}
+	else emitByte(0xE9);
+
+	Fixup fixup;
+	fixup.offset = code.size();
+	fixup.target = target;
+	fixups.push_back(fixup);
+	emitInt(0);
+}
+
+size_t JitCompiler::emitLocalJump(unsigned char condition)
+{
+	if (condition)
+	{
+		emitByte(0x0F);
+		emitByte(condition);
+	}
+	else emitByte(0xE9);
+
+	emitInt(0);
+	return code.size() - 4;
+}
+
+void JitCompiler::bindLocalJump(size_t offset)
+{
+	unsigned int displacement = (unsigned int)(code.size() - (offset + 4));
+	for (int j = 0; j < 4; j++) code[offset + j] = (displacement >> (8 * j)) & 0xFF;
+}
+
+void JitCompiler::emitFailureCheck()
+{
+	emitJump(0x84, failureTarget);						/// jz failure
+}
+
+void JitCompiler::emitBranch(size_t index, const Helper* comparisons, bool canFail)
+{
+	const BytecodeInstruction& comparison = function.code[index + 1];
+	const BytecodeInstruction& jump = function.code[index + 2];
+
+	emitCall(comparisons[comparison.opcode - lessOpcode], function.code[index].operand);
+	if (canFail) emitJump(0x88, failureTarget);		/// js failure
+	emitJump(jump.opcode == jumpIfFalseOpcode ? 0x84 : 0x85, jump.operand);
+}
+
+unsigned int JitCompiler::machineOffset(const void* member) const
+{
+	return (unsigned int)(reinterpret_cast<const char*>(member) - reinterpret_cast<const char*>(&machine));
+}
+
+void JitCompiler::emitStackEnd()
+{
+	emitByte(0x48); emitByte(0x8B); emitByte(0x8B);		/// mov rcx, [rbx + stackSize]
+	emitInt(machineOffset(&machine.stackSize));
+	emitByte(0x48); emitByte(0x69); emitByte(0xC9);		/// imul rcx, rcx, sizeof(Number)
+	emitInt(sizeof(Number));
+	emitByte(0x48); emitByte(0x03); emitByte(0x8B);		/// add rcx, [rbx + stackEntries]
+	emitInt(machineOffset(&machine.stackEntries));
+}
+
+void JitCompiler::emitSinglePartCheck(int depth, std::vector<size_t>& slow)
+{
+	emitByte(0x48); emitByte(0x83); emitByte(0xB9);		/// cmp qword [rcx + partsSize], 1
+	emitInt((unsigned int)(offsetof(Number, partsSize) - depth * sizeof(Number)));
+	emitByte(1);
+	slow.push_back(emitLocalJump(0x85));				/// jne slow
+}
+
+void JitCompiler::emitInlineAdd(bool subtract, Helper helper, int operand, const Number* constant)
+{
+	if (constant && constant->partsSize != 1)
+	{
+		emitCall(helper, operand);
+		return;
+	}
+
+	/// The first number is on top of the stack if the second is a constant, below it otherwise
+	int depth = (constant ? 1 : 2);
+	std::vector<size_t> slow;
+	emitStackEnd();
+	emitSinglePartCheck(1, slow);
+	if (!constant)
+	{
+		emitSinglePartCheck(2, slow);
+		emitByte(0x48); emitByte(0x8B); emitByte(0x91);	/// mov rdx, [rcx + parts]
+		emitInt((unsigned int)(offsetof(Number, parts) - sizeof(Number)));
+		emitByte(0x8B); emitByte(0x12);					/// mov edx, [rdx]
+	}
+	emitByte(0x48); emitByte(0x8B); emitByte(0x81);		/// mov rax, [rcx + parts]
+	emitInt((unsigned int)(offsetof(Number, parts) - depth * sizeof(Number)));
+	emitByte(0x8B); emitByte(0x08);						/// mov ecx, [rax]
+
+	if (constant)
+	{
+		emitByte(0x81); emitByte(subtract ? 0xE9 : 0xC1);	/// sub (add) ecx, constant
+		emitInt(constant->parts[0]);
+	}
+	else
+	{
+		emitByte(subtract ? 0x29 : 0x01); emitByte(0xD1);	/// sub (add) ecx, edx
+	}
+
+	if (subtract)
+	{
+		/// A larger number subtracted gives 0
+		emitByte(0x73); emitByte(0x02);					/// jae store
+		emitByte(0x31); emitByte(0xC9);					/// xor ecx, ecx
+	}
+	else slow.push_back(emitLocalJump(0x82));			/// jc slow
+	emitByte(0x89); emitByte(0x08);						/// mov [rax], ecx
+
+	if (!constant)
+	{
+		emitByte(0x48); emitByte(0xFF); emitByte(0x8B);	/// dec qword [rbx + stackSize]
+		emitInt(machineOffset(&machine.stackSize));
+	}
+	size_t done = emitLocalJump(0);
+
+	for (size_t i = 0; i < slow.size(); i++) bindLocalJump(slow[i]);
+	emitCall(helper, operand);
+	bindLocalJump(done);
+}
+
+void JitCompiler::emitInlineBranch(Opcode comparison, const BytecodeInstruction& jump, Helper helper, int operand, const Number* constant)
+{
+	bool jumpIfTrue = (jump.opcode == jumpIfTrueOpcode);
+	if (constant && constant->partsSize != 1)
+	{
+		emitCall(helper, operand);
+		emitJump(jumpIfTrue ? 0x85 : 0x84, jump.operand);
+		return;
+	}
+
+	std::vector<size_t> slow;
+	emitStackEnd();
+	emitSinglePartCheck(1, slow);
+	if (constant)
+	{
+		emitByte(0x48); emitByte(0x8B); emitByte(0x81);	/// mov rax, [rcx + parts]
+		emitInt((unsigned int)(offsetof(Number, parts) - sizeof(Number)));
+		emitByte(0x8B); emitByte(0x00);					/// mov eax, [rax]
+		emitByte(0x48); emitByte(0xFF); emitByte(0x8B);	/// dec qword [rbx + stackSize]
+		emitInt(machineOffset(&machine.stackSize));
+		emitByte(0x3D);									/// cmp eax, constant
+		emitInt(constant->parts[0]);
+	}
+	else
+	{
+		emitSinglePartCheck(2, slow);
+		emitByte(0x48); emitByte(0x8B); emitByte(0x91);	/// mov rdx, [rcx + parts]
+		emitInt((unsigned int)(offsetof(Number, parts) - sizeof(Number)));
+		emitByte(0x8B); emitByte(0x12);					/// mov edx, [rdx]
+		emitByte(0x48); emitByte(0x8B); emitByte(0x81);	/// mov rax, [rcx + parts]
+		emitInt((unsigned int)(offsetof(Number, parts) - 2 * sizeof(Number)));
+		emitByte(0x8B); emitByte(0x00);					/// mov eax, [rax]
+		emitByte(0x48); emitByte(0x83); emitByte(0xAB);	/// sub qword [rbx + stackSize], 2
+		emitInt(machineOffset(&machine.stackSize));
+		emitByte(2);
+		emitByte(0x39); emitByte(0xD0);					/// cmp eax, edx
+	}
+
+	/// jb, ja or je when the jump is taken on a true comparison, the opposite otherwise
+	static const unsigned char whenTrue[] = {0x82, 0x87, 0x84};
+	static const unsigned char whenFalse[] = {0x83, 0x86, 0x85};
+	int kind = comparison - lessOpcode;
+	emitFlagJump(jumpIfTrue ? whenTrue[kind] : whenFalse[kind], jump.operand);
+	size_t done = emitLocalJump(0);
+
+	for (size_t i = 0; i < slow.size(); i++) bindLocalJump(slow[i]);
+	emitCall(helper, operand);
+	emitJump(jumpIfTrue ? 0x85 : 0x84, jump.operand);
+	bindLocalJump(done);
+}
+
+void JitCompiler::emitExit(size_t index)
+{
+	emitByte(0xB8);										/// mov eax, index
+	emitInt(index);
+	emitJump(0, epilogueTarget);
+}
+
+size_t JitCompiler::emitInstruction(size_t index)
+{
+	const BytecodeInstruction& instruction = function.code[index];
+	const unsigned char jumpIfZero = 0x84;
+	const unsigned char jumpIfNotZero = 0x85;
+
+	switch (instruction.opcode)
+	{
+	case pushConstantOpcode:
+	{
+		/// A constant operand is used in place rather than pushed
+		static const Helper constantHelpers[] = {addConstant, subtractConstant, multiplyConstant, divideConstant, moduloConstant};
+		static const Helper constantBranches[] = {lessConstantBranch, greaterConstantBranch, equalConstantBranch};
+		const Number& constant = machine.context.program->constants[instruction.operand];
+		if (fusableBranch(index))
+		{
+			Opcode comparison = function.code[index + 1].opcode;
+			emitInlineBranch(comparison, function.code[index + 2], constantBranches[comparison - lessOpcode], instruction.operand, &constant);
+			return 3;
+		}
+		if (index + 1 < function.code.size() && !targets[index + 1])
+		{
+			Opcode next = function.code[index + 1].opcode;
+			if (next == addOpcode || next == subtractOpcode)
+			{
+				emitInlineAdd(next == subtractOpcode, constantHelpers[next - addOpcode], instruction.operand, &constant);
+				return 2;
+			}
+			if (next >= addOpcode && next <= moduloOpcode)
+			{
+				emitCall(constantHelpers[next - addOpcode], instruction.operand);
+				if (next == divideOpcode || next == moduloOpcode) emitFailureCheck();
+				return 2;
+			}
+		}
+		emitCall(pushConstant, instruction.operand);
+		return 1;
+	}
+	case loadVariableOpcode:
+	{
+		/// So is the second operand of arithmetic or of a comparison read from a variable
+		static const Helper variableHelpers[] = {addVariable, subtractVariable, multiplyVariable, divideVariable, moduloVariable};
+		static const Helper variableBranches[] = {lessVariableBranch, greaterVariableBranch, equalVariableBranch};
+		if (fusableBranch(index))
+		{
+			emitBranch(index, variableBranches, true);
+			return 3;
+		}
+		if (index + 1 < function.code.size() && !targets[index + 1])
+		{
+			Opcode next = function.code[index + 1].opcode;
+			if (next >= addOpcode && next <= moduloOpcode)
+			{
+				emitCall(variableHelpers[next - addOpcode], instruction.operand);
+				emitFailureCheck();
+				return 2;
+			}
+		}
+		emitCall(loadVariable, instruction.operand);
+		emitFailureCheck();
+		return 1;
+	}
+	case storeVariableOpcode:
+		emitCall(storeVariable, instruction.operand);
+		return 1;
+	case printOpcode:
+		emitCall(print, instruction.operand);
+		return 1;
+	case addOpcode:
+		emitInlineAdd(false, add, instruction.operand, nullptr);
+		return 1;
+	case subtractOpcode:
+		emitInlineAdd(true, subtract, instruction.operand, nullptr);
+		return 1;
+	case multiplyOpcode:
+		emitCall(multiply, instruction.operand);
+		return 1;
+	case divideOpcode:
+		emitCall(divide, instruction.operand);
+		emitFailureCheck();
+		return 1;
+	case moduloOpcode:
+		emitCall(modulo, instruction.operand);
+		emitFailureCheck();
+		return 1;
+	case divideModuloOpcode:
+		emitCall(divideModulo, instruction.operand);
+		emitFailureCheck();
+		return 1;
+	case lessOpcode:
+	case greaterOpcode:
+	case equalOpcode:
+	{
+		/// A comparison only tested by the next jump does not push its result
+		static const Helper pushing[] = {less, greater, equal};
+		static const Helper branching[] = {lessBranch, greaterBranch, equalBranch};
+		int comparison = instruction.opcode - lessOpcode;
+
+		if (fusable(index, jumpIfFalseOpcode) || fusable(index, jumpIfTrueOpcode))
+		{
+			emitInlineBranch(instruction.opcode, function.code[index + 1], branching[comparison], instruction.operand, nullptr);
+			return 2;
+		}
+		emitCall(pushing[comparison], instruction.operand);
+		return 1;
+	}
+	case notOpcode:
+		emitCall(negate, instruction.operand);
+		return 1;
+	case jumpOpcode:
+		emitJump(0, instruction.operand);
+		return 1;
+	case jumpIfFalseOpcode:
+		emitCall(popCondition, instruction.operand);
+		emitJump(jumpIfZero, instruction.operand);
+		return 1;
+	case jumpIfTrueOpcode:
+		emitCall(popCondition, instruction.operand);
+		emitJump(jumpIfNotZero, instruction.operand);
+		return 1;
+	case checkFunctionOpcode:
+		emitCall(checkFunction, instruction.operand);
+		emitFailureCheck();
+		return 1;
+	case enterLoopOpcode:
+		emitCall(enterLoop, instruction.operand);
+		return 1;
+	case loadInvariantOpcode:
+		emitCall(loadInvariant, instruction.operand);
+		emitJump(jumpIfZero, index + 2);
+		return 1;
+	case storeInvariantOpcode:
+		emitCall(storeInvariant, instruction.operand);
+		return 1;
+	case checkVariableOpcode:
+		emitCall(checkVariable, instruction.operand);
+		emitFailureCheck();
+		return 1;
+	case lessCounterOpcode:
+		if (fusable(index, jumpIfFalseOpcode))
+		{
+			emitCall(lessCounterBranch, instruction.operand);
+			emitJump(jumpIfZero, function.code[index + 1].operand);
+			return 2;
+		}
+		emitCall(lessCounter, instruction.operand);
+		return 1;
+	case stepCounterOpcode:
+		emitCall(stepCounter, instruction.operand);
+		emitFailureCheck();
+		return 1;
+	case storeArgumentOpcode:
+		emitCall(storeArgument, instruction.operand);
+		return 1;
+	case loadArgumentOpcode:
+		emitCall(loadArgument, instruction.operand);
+		return 1;
+	default:
+		/// Input, definitions, calls and returns are executed by the machine
+		emitExit(index);
+		return 1;
+	}
+}
+
+bool JitCompiler::link(JitCode& result)
+{
+	/// The labels of the failure exit and of the epilogue
+	size_t failure = code.size();
+	emitByte(0x31); emitByte(0xC0);						/// xor eax, eax
+	size_t epilogue = code.size();
+	emitByte(0x48); emitByte(0x83); emitByte(0xC4); emitByte(0x20);		/// add rsp, 32
+	emitByte(0x5B);										/// pop rbx
+	emitByte(0xC3);										/// ret
+
+	for (size_t i = 0; i < fixups.size(); i++)
+	{
+		size_t target;
+		if (fixups[i].target == epilogueTarget) target = epilogue;
+		else if (fixups[i].target == failureTarget) target = failure;
+		else target = labels[fixups[i].target];
+
+		if (target == JitCode::noEntry) return false;
+
+		unsigned int displacement = (unsigned int)(target - (fixups[i].offset + 4));
+		for (int j = 0; j < 4; j++) code[fixups[i].offset + j] = (displacement >> (8 * j)) & 0xFF;
+	}
+
+	/// The memory is writable only until the code is copied in
+#if defined(JIT_X64) && defined(_WIN32)
+	unsigned char* memory = (unsigned char*)VirtualAlloc(nullptr, code.size(), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	if (memory == nullptr) return false;
+
+	memcpy(memory, code.data(), code.size());
+	DWORD protection;
+	if (!VirtualProtect(memory, code.size(), PAGE_EXECUTE_READ, &protection))
+	{
+		VirtualFree(memory, 0, MEM_RELEASE);
+		return false;
+	}
+	FlushInstructionCache(GetCurrentProcess(), memory, code.size());
+#elif defined(JIT_X64)
+	void* mapping = mmap(nullptr, code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mapping == MAP_FAILED) return false;
+
+	unsigned char* memory = (unsigned char*)mapping;
+	memcpy(memory, code.data(), code.size());
+	if (mprotect(memory, code.size(), PROT_READ | PROT_EXEC))
+	{
+		munmap(memory, code.size());
+		return false;
+	}
+#else
+	return false;
+#endif
+
+#if defined(JIT_X64)
+	result.release();
+	result.memory = memory;
+	result.size = code.size();
+	result.entries = labels;
+	result.entries.pop_back();
+	return true;
+#endif
+}
+
+bool JitCompiler::isSupported()
+{
+#if defined(JIT_X64)
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool JitCompiler::compile(const VirtualMachine& machine, const BytecodeFunction& function, JitCode& result)
+{
+	if (!isSupported()) return false;
+
+	JitCompiler compiler(machine, function);
+	compiler.findTargets();
+
+	/// The entry saves rbx, keeps the stack aligned with room for the shadow space
+	/// of Windows calls, and jumps to the address it is given
+	compiler.emitByte(0x53);							/// push rbx
+	compiler.emitByte(0x48); compiler.emitByte(0x83); compiler.emitByte(0xEC); compiler.emitByte(0x20);	/// sub rsp, 32
+#if defined(_WIN32)
+	compiler.emitByte(0x48); compiler.emitByte(0x89); compiler.emitByte(0xCB);	/// mov rbx, rcx
+	compiler.emitByte(0xFF); compiler.emitByte(0xE2);	/// jmp rdx
+#else
+	compiler.emitByte(0x48); compiler.emitByte(0x89); compiler.emitByte(0xFB);	/// mov rbx, rdi
+	compiler.emitByte(0xFF); compiler.emitByte(0xE6);	/// jmp rsi
+#endif
+
+	size_t size = function.code.size();
+	compiler.labels.assign(size + 1, JitCode::noEntry);
+	for (size_t i = 0; i < size;)
+	{
+		compiler.labels[i] = compiler.code.size();
+		i += compiler.emitInstruction(i);
+	}
+
+	return compiler.link(result);
+}
+
+const Number* JitCompiler::variable(VirtualMachine& machine, int slot)
+{
+	const Binding& binding = machine.context.environment->lookup(slot);
+	if (binding.kind == Binding::numberBinding) return &binding.number;
+
+	*machine.context.state = InterpreterErrorFlags::undefinedVariableFlag;
+	*machine.context.undefinedObject = machine.context.program->names[slot];
+	return nullptr;
+}
+
+int JitCompiler::pushConstant(VirtualMachine& machine, int constant)
+{
+	machine.push() = machine.context.program->constants[constant];
+	return 1;
+}
+
+int JitCompiler::loadVariable(VirtualMachine& machine, int slot)
+{
+	const Number* value = variable(machine, slot);
+	if (!value) return 0;
+
+	machine.push() = *value;
+	return 1;
+}
+
+int JitCompiler::storeVariable(VirtualMachine& machine, int slot)
+{
+	machine.context.environment->defineNumber(slot, std::move(machine.stack[--machine.stackSize]));
+	return 1;
+}
+
+int JitCompiler::print(VirtualMachine& machine, int)
+{
+	*machine.context.os << machine.stack[--machine.stackSize] << '\n';
+	return 1;
+}
+
+int JitCompiler::add(VirtualMachine& machine, int)
+{
+	machine.stackSize--;
+	machine.stack[machine.stackSize - 1] += machine.stack[machine.stackSize];
+	return 1;
+}
+
+int JitCompiler::subtract(VirtualMachine& machine, int)
+{
+	machine.stackSize--;
+	machine.stack[machine.stackSize - 1] -= machine.stack[machine.stackSize];
+	return 1;
+}
+
+int JitCompiler::multiply(VirtualMachine& machine, int)
+{
+	machine.stackSize--;
+	Number& first = machine.stack[machine.stackSize - 1];
+	Number::multiply(first, machine.stack[machine.stackSize], first);
+	return 1;
+}
+
+int JitCompiler::divide(VirtualMachine& machine, int)
+{
+	const Number& divider = machine.stack[--machine.stackSize];
+	if (divider.isZero())
+	{
+		*machine.context.state = InterpreterErrorFlags::divisionByZeroFlag;
+		return 0;
+	}
+
+	Number& first = machine.stack[machine.stackSize - 1];
+	first /= divider;
+	return 1;
+}
+
+int JitCompiler::modulo(VirtualMachine& machine, int)
+{
+	const Number& divider = machine.stack[--machine.stackSize];
+	if (divider.isZero())
+	{
+		*machine.context.state = InterpreterErrorFlags::divisionByZeroFlag;
+		return 0;
+	}
+
+	Number& first = machine.stack[machine.stackSize - 1];
+	first %= divider;
+	return 1;
+}
+
+int JitCompiler::divideModulo(VirtualMachine& machine, int)
+{
+	Number& first = machine.stack[machine.stackSize - 2];
+	Number& second = machine.stack[machine.stackSize - 1];
+	if (second.isZero())
+	{
+		*machine.context.state = InterpreterErrorFlags::divisionByZeroFlag;
+		return 0;
+	}
+
+	Number quotient, remainder;
+	first.divmod(second, quotient, remainder);
+	first = std::move(quotient);
+	second = std::move(remainder);
+	return 1;
+}
+
+int JitCompiler::addConstant(VirtualMachine& machine, int constant)
+{
+	machine.stack[machine.stackSize - 1] += machine.context.program->constants[constant];
+	return 1;
+}
+
+int JitCompiler::subtractConstant(VirtualMachine& machine, int constant)
+{
+	machine.stack[machine.stackSize - 1] -= machine.context.program->constants[constant];
+	return 1;
+}
+
+int JitCompiler::multiplyConstant(VirtualMachine& machine, int constant)
+{
+	Number& first = machine.stack[machine.stackSize - 1];
+	Number::multiply(first, machine.context.program->constants[constant], first);
+	return 1;
+}
+
+int JitCompiler::divideConstant(VirtualMachine& machine, int constant)
+{
+	const Number& divider = machine.context.program->constants[constant];
+	if (divider.isZero())
+	{
+		*machine.context.state = InterpreterErrorFlags::divisionByZeroFlag;
+		return 0;
+	}
+
+	Number& first = machine.stack[machine.stackSize - 1];
+	first /= divider;
+	return 1;
+}
+
+int JitCompiler::moduloConstant(VirtualMachine& machine, int constant)
+{
+	const Number& divider = machine.context.program->constants[constant];
+	if (divider.isZero())
+	{
+		*machine.context.state = InterpreterErrorFlags::divisionByZeroFlag;
+		return 0;
+	}
+
+	Number& first = machine.stack[machine.stackSize - 1];
+	first %= divider;
+	return 1;
+}
+
+int JitCompiler::addVariable(VirtualMachine& machine, int slot)
+{
+	const Number* value = variable(machine, slot);
+	if (!value) return 0;
+
+	machine.stack[machine.stackSize - 1] += *value;
+	return 1;
+}
+
+int JitCompiler::subtractVariable(VirtualMachine& machine, int slot)
+{
+	const Number* value = variable(machine, slot);
+	if (!value) return 0;
+
+	machine.stack[machine.stackSize - 1] -= *value;
+	return 1;
+}
+
+int JitCompiler::multiplyVariable(VirtualMachine& machine, int slot)
+{
+	const Number* value = variable(machine, slot);
+	if (!value) return 0;
+
+	Number& first = machine.stack[machine.stackSize - 1];
+	Number::multiply(first, *value, first);
+	return 1;
+}
+
+int JitCompiler::divideVariable(VirtualMachine& machine, int slot)
+{
+	const Number* value = variable(machine, slot);
+	if (!value) return 0;
+	if (value->isZero())
+	{
+		*machine.context.state = InterpreterErrorFlags::divisionByZeroFlag;
+		return 0;
+	}
+
+	Number& first = machine.stack[machine.stackSize - 1];
+	first /= *value;
+	return 1;
+}
+
+int JitCompiler::moduloVariable(VirtualMachine& machine, int slot)
+{
+	const Number* value = variable(machine, slot);
+	if (!value) return 0;
+	if (value->isZero())
+	{
+		*machine.context.state = InterpreterErrorFlags::divisionByZeroFlag;
+		return 0;
+	}
+
+	Number& first = machine.stack[machine.stackSize - 1];
+	first %= *value;
+	return 1;
+}
+
+int JitCompiler::less(VirtualMachine& machine, int)
+{
+	bool result = lessBranch(machine, 0);
+	machine.push() = machine.context.program->constants[result ? 1 : 0];
+	return 1;
+}
+
+int JitCompiler::greater(VirtualMachine& machine, int)
+{
+	bool result = greaterBranch(machine, 0);
+	machine.push() = machine.context.program->constants[result ? 1 : 0];
+	return 1;
+}
+
+int JitCompiler::equal(VirtualMachine& machine, int)
+{
+	bool result = equalBranch(machine, 0);
+	machine.push() = machine.context.program->constants[result ? 1 : 0];
+	return 1;
+}
+
+int JitCompiler::negate(VirtualMachine& machine, int)
+{
+	bool result = !machine.stack[--machine.stackSize];
+	machine.push() = machine.context.program->constants[result ? 1 : 0];
+	return 1;
+}
+
+int JitCompiler::checkFunction(VirtualMachine& machine, int slot)
+{
+	if (machine.context.environment->lookup(slot).kind == Binding::functionBinding) return 1;
+
+	*machine.context.state = InterpreterErrorFlags::undefinedFunctionFlag;
+	*machine.context.undefinedObject = machine.context.program->names[slot];
+	return 0;
+}
+
+int JitCompiler::enterLoop(VirtualMachine& machine, int loop)
+{
+	machine.context.environment->loopEpochs[loop]++;
+	return 1;
+}
+
+int JitCompiler::storeInvariant(VirtualMachine& machine, int entry)
+{
+	Environment& environment = *machine.context.environment;
+	Environment::InvariantCache& cache = environment.invariantCaches[entry];
+	cache.value = machine.stack[machine.stackSize - 1];
+	cache.epoch = environment.loopEpochs[cache.loop];
+	return 1;
+}
+
+int JitCompiler::checkVariable(VirtualMachine& machine, int slot)
+{
+	if (machine.context.environment->lookup(slot).kind == Binding::numberBinding) return 1;
+
+	*machine.context.state = InterpreterErrorFlags::undefinedVariableFlag;
+	*machine.context.undefinedObject = machine.context.program->names[slot];
+	return 0;
+}
+
+int JitCompiler::lessCounter(VirtualMachine& machine, int slot)
+{
+	bool result = machine.context.environment->lookup(slot).number < machine.stack[machine.stackSize - 1];
+	machine.stack[machine.stackSize - 1] = machine.context.program->constants[result ? 1 : 0];
+	return 1;
+}
+
+int JitCompiler::stepCounter(VirtualMachine& machine, int slot)
+{
+	Environment& environment = *machine.context.environment;
+	const Number& step = machine.stack[--machine.stackSize];
+	Number* counter = environment.localNumber(slot);
+	if (counter)
+	{
+		*counter += step;
+		return 1;
+	}
+
+	const Binding& binding = environment.lookup(slot);
+	if (binding.kind != Binding::numberBinding) return checkVariable(machine, slot);
+	environment.defineNumber(slot, binding.number + step);
+	return 1;
+}
+
+int JitCompiler::storeArgument(VirtualMachine& machine, int site)
+{
+	machine.context.environment->inlineArguments[site] = std::move(machine.stack[--machine.stackSize]);
+	return 1;
+}
+
+int JitCompiler::loadArgument(VirtualMachine& machine, int site)
+{
+	machine.push() = machine.context.environment->inlineArguments[site];
+	return 1;
+}
+
+int JitCompiler::popCondition(VirtualMachine& machine, int)
+{
+	return machine.stack[--machine.stackSize] ? 1 : 0;
+}
+
+int JitCompiler::lessBranch(VirtualMachine& machine, int)
+{
+	machine.stackSize -= 2;
+	return machine.stack[machine.stackSize] < machine.stack[machine.stackSize + 1];
+}
+
+int JitCompiler::greaterBranch(VirtualMachine& machine, int)
+{
+	machine.stackSize -= 2;
+	return machine.stack[machine.stackSize] > machine.stack[machine.stackSize + 1];
+}
+
+int JitCompiler::equalBranch(VirtualMachine& machine, int)
+{
+	machine.stackSize -= 2;
+	return machine.stack[machine.stackSize] == machine.stack[machine.stackSize + 1];
+}
+
+int JitCompiler::lessCounterBranch(VirtualMachine& machine, int slot)
+{
+	return machine.context.environment->lookup(slot).number < machine.stack[--machine.stackSize];
+}
+
+int JitCompiler::loadInvariant(VirtualMachine& machine, int entry)
+{
+	/// 1 when the cached value was pushed
+	const Environment& environment = *machine.context.environment;
+	const Environment::InvariantCache& cache = environment.invariantCaches[entry];
+	if (cache.epoch != environment.loopEpochs[cache.loop]) return 0;
+
+	machine.push() = cache.value;
+	return 1;
+}
+
+int JitCompiler::lessConstantBranch(VirtualMachine& machine, int constant)
+{
+	return machine.stack[--machine.stackSize] < machine.context.program->constants[constant];
+}
+
+int JitCompiler::greaterConstantBranch(VirtualMachine& machine, int constant)
+{
+	return machine.stack[--machine.stackSize] > machine.context.program->constants[constant];
+}
+
+int JitCompiler::equalConstantBranch(VirtualMachine& machine, int constant)
+{
+	return machine.stack[--machine.stackSize] == machine.context.program->constants[constant];
+}
+
+int JitCompiler::lessVariableBranch(VirtualMachine& machine, int slot)
+{
+	const Number* value = variable(machine, slot);
+	if (!value) return -1;
+	return machine.stack[--machine.stackSize] < *value;
+}
+
+int JitCompiler::greaterVariableBranch(VirtualMachine& machine, int slot)
+{
+	const Number* value = variable(machine, slot);
+	if (!value) return -1;
+	return machine.stack[--machine.stackSize] > *value;
+}
+
+int JitCompiler::equalVariableBranch(VirtualMachine& machine, int slot)
+{
+	const Number* value = variable(machine, slot);
+	if (!value) return -1;
+	return machine.stack[--machine.stackSize] == *value;
+}
\ No newline at end of file
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <vector>
+
+#include "Bytecode.h"
+
+class VirtualMachine;
+
+/// Machine code of one bytecode function, in memory it owns
+class JitCode
+{
+private:
+	const static size_t noEntry = (size_t)-1;
+
+	unsigned char* memory;
+	size_t size;
+	/// Offset of the code of every instruction, noEntry inside fused instructions
+	std::vector<size_t> entries;
+
+	void release();
+
+public:
+	JitCode();
+	JitCode(JitCode&&) noexcept;
+	JitCode& operator=(JitCode&&) noexcept;
+	JitCode(const JitCode&) = delete;
+	JitCode& operator=(const JitCode&) = delete;
+	~JitCode();
+
+	bool isCompiled() const;
+	/// Runs the function from pc up to an instruction left to the machine and returns
+	/// its index. An error stops the code with the state of the machine set.
+	size_t run(VirtualMachine&, size_t pc) const;
+
+	friend class JitCompiler;
+};
+
+/// Template compiler from bytecode to x86-64. Every instruction becomes a call of a
+/// helper doing its work on the VirtualMachine, with the jumps of the function turned
+/// into native jumps, so the dispatch of the machine is left out. Definitions, calls,
+/// returns and input go back to the machine, which enters the code again after them.
+///
+/// Addition, subtraction and comparisons of numbers on the stack or with a constant
+/// are done in the code when both numbers have one part, and call the helper when
+/// one has more or the sum carries. Variables are always read by the helpers, which
+/// look them up in the Environment, and multiplication and division always call them.
+class JitCompiler
+{
+private:
+	typedef int (*Helper)(VirtualMachine&, int operand);
+
+	/// Places in the code a label is jumped to
+	enum FixupTarget : int
+	{
+		epilogueTarget = -1,
+		failureTarget = -2
+	};
+
+	struct Fixup
+	{
+		/// Offset of the 32-bit displacement
+		size_t offset;
+		/// Instruction index, or a FixupTarget
+		int target;
+	};
+
+	const VirtualMachine& machine;
+	const BytecodeFunction& function;
+	std::vector<unsigned char> code;
+	std::vector<size_t> labels;
+	std::vector<Fixup> fixups;
+	/// Instructions control may reach other than from the previous one
+	std::vector<bool> targets;
+
+	JitCompiler(const VirtualMachine&, const BytecodeFunction&);
+
+	void findTargets();
+	bool fusable(size_t index, Opcode second) const;
+	bool fusableBranch(size_t index) const;
+
+	void emitByte(unsigned char);
+	void emitInt(unsigned int);
+	void emitCall(Helper, int operand);
+	void emitJump(unsigned char condition, int target);
+	/// Jumps on the flags as they are, where emitJump tests the result of a helper
+	void emitFlagJump(unsigned char condition, int target);
+	/// A jump inside the code of one instruction, returns the offset to bind it at
+	size_t emitLocalJump(unsigned char condition);
+	void bindLocalJump(size_t offset);
+	void emitFailureCheck();
+	void emitBranch(size_t index, const Helper* comparisons, bool canFail);
+	/// Offset of a member of the machine from rbx
+	unsigned int machineOffset(const void* member) const;
+	/// Leaves in rcx the address past the top of the stack
+	void emitStackEnd();
+	/// Jumps to slow unless the number depth entries below the end of the stack has one part
+	void emitSinglePartCheck(int depth, std::vector<size_t>& slow);
+	void emitInlineAdd(bool subtract, Helper helper, int operand, const Number* constant);
+	void emitInlineBranch(Opcode comparison, const BytecodeInstruction& jump, Helper helper, int operand, const Number* constant);
+	void emitExit(size_t index);
+	size_t emitInstruction(size_t index);
+	bool link(JitCode&);
+
+	/// The number bound to slot, nullptr after setting the error
+	static const Number* variable(VirtualMachine&, int slot);
+
+	/// Helpers, they return 0 after an error unless noted
+	static int pushConstant(VirtualMachine&, int);
+	static int loadVariable(VirtualMachine&, int);
+	static int storeVariable(VirtualMachine&, int);
+	static int print(VirtualMachine&, int);
+	static int add(VirtualMachine&, int);
+	static int subtract(VirtualMachine&, int);
+	static int multiply(VirtualMachine&, int);
+	static int divide(VirtualMachine&, int);
+	static int modulo(VirtualMachine&, int);
+	static int divideModulo(VirtualMachine&, int);
+	static int addConstant(VirtualMachine&, int);
+	static int subtractConstant(VirtualMachine&, int);
+	static int multiplyConstant(VirtualMachine&, int);
+	static int divideConstant(VirtualMachine&, int);
+	static int moduloConstant(VirtualMachine&, int);
+	static int addVariable(VirtualMachine&, int);
+	static int subtractVariable(VirtualMachine&, int);
+	static int multiplyVariable(VirtualMachine&, int);
+	static int divideVariable(VirtualMachine&, int);
+	static int moduloVariable(VirtualMachine&, int);
+	static int less(VirtualMachine&, int);
+	static int greater(VirtualMachine&, int);
+	static int equal(VirtualMachine&, int);
+	static int negate(VirtualMachine&, int);
+	static int checkFunction(VirtualMachine&, int);
+	static int enterLoop(VirtualMachine&, int);
+	static int storeInvariant(VirtualMachine&, int);
+	static int checkVariable(VirtualMachine&, int);
+	static int lessCounter(VirtualMachine&, int);
+	static int stepCounter(VirtualMachine&, int);
+	static int storeArgument(VirtualMachine&, int);
+	static int loadArgument(VirtualMachine&, int);
+	/// These return the condition they test and cannot fail
+	static int popCondition(VirtualMachine&, int);
+	static int lessBranch(VirtualMachine&, int);
+	static int greaterBranch(VirtualMachine&, int);
+	static int equalBranch(VirtualMachine&, int);
+	static int lessCounterBranch(VirtualMachine&, int);
+	static int lessConstantBranch(VirtualMachine&, int);
+	static int greaterConstantBranch(VirtualMachine&, int);
+	static int equalConstantBranch(VirtualMachine&, int);
+	/// These return the condition, or -1 after an error
+	static int lessVariableBranch(VirtualMachine&, int);
+	static int greaterVariableBranch(VirtualMachine&, int);
+	static int equalVariableBranch(VirtualMachine&, int);
+	static int loadInvariant(VirtualMachine&, int);
+
+public:
+	/// Whether machine code can be made on this platform
+	static bool isSupported();
+	/// Returns false if the function could not be compiled
+	static bool compile(const VirtualMachine&, const BytecodeFunction&, JitCode&);
+};
\ No newline at end of file
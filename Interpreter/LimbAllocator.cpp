@@ -0,0 +1,101 @@
+#include "LimbAllocator.h"
+
+static thread_local LimbAllocator::Statistics currentStatistics = { 0, 0, 0 };
+thread_local LimbAllocator::FreeLists LimbAllocator::freeLists;
+thread_local LimbAllocator::FreeListsOwner LimbAllocator::freeListsOwner;
+
+LimbAllocator::FreeListsOwner::~FreeListsOwner()
+{
+	for (size_t i = 0; i < numberOfClasses; i++)
+	{
+		for (size_t j = 0; j < freeLists.blockCount[i]; j++) delete[] freeLists.blocks[i][j];
+		freeLists.blockCount[i] = 0;
+	}
+	freeLists.cachedParts = 0;
+	freeLists.destroyed = true;
+}
+
+size_t LimbAllocator::sizeClass(size_t capacity)
+{
+	size_t index = 0;
+	for (capacity = (capacity - 1) / smallestClass; capacity > 0; capacity >>= 1) index++;
+	return index;
+}
+
+unsigned int* LimbAllocator::allocate(size_t& capacity)
+{
+	size_t index = sizeClass(capacity);
+
+	if (index >= numberOfClasses || freeLists.destroyed)
+	{
+		currentStatistics.misses++;
+		return new unsigned int[capacity];
+	}
+
+	capacity = smallestClass << index;
+	if (freeLists.blockCount[index] > 0)
+	{
+		currentStatistics.hits++;
+		freeLists.cachedParts -= capacity;
+		return freeLists.blocks[index][--freeLists.blockCount[index]];
+	}
+
+	currentStatistics.misses++;
+	return new unsigned int[capacity];
+}
+
+void LimbAllocator::release(unsigned int* block, size_t capacity)
+{
+	size_t index = sizeClass(capacity);
+
+	currentStatistics.releases++;
+	if (index >= numberOfClasses || freeLists.destroyed || (smallestClass << index) != capacity ||
+		freeLists.blockCount[index] == maxBlocksPerClass || freeLists.cachedParts + capacity > maxCachedParts)
+	{
+		delete[] block;
+		return;
+	}
+
+	if (!freeLists.registered)
+	{
+		freeLists.registered = true;
+		freeListsOwner.active = true;
+	}
+
+	freeLists.cachedParts += capacity;
+	freeLists.blocks[index][freeLists.blockCount[index]++] = block;
+}
+
+LimbAllocator::Statistics LimbAllocator::statistics()
+{
+	return currentStatistics;
+}
+
+void LimbAllocator::resetStatistics()
+{
+	currentStatistics.hits = 0;
+	currentStatistics.misses = 0;
+	currentStatistics.releases = 0;
+}
+
+LimbBuffer::LimbBuffer(size_t size)
+{
+	capacity = (size ? size : 1);
+	block = LimbAllocator::allocate(capacity);
+	for (size_t i = 0; i < size; i++) block[i] = 0;
+}
+
+LimbBuffer::~LimbBuffer()
+{
+	LimbAllocator::release(block, capacity);
+}
+
+unsigned int* LimbBuffer::data()
+{
+	return block;
+}
+
+unsigned int& LimbBuffer::operator[](size_t index)
+{
+	return block[index];
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+
+/// Heap storage for Number limbs. Blocks are rounded up to power of two size
+/// classes and released blocks are kept in per-thread free lists, so the short
+/// lived temporaries of the interpreter rarely reach the global heap.
+class LimbAllocator
+{
+private:
+	const static size_t smallestClass = 8;
+	const static size_t numberOfClasses = 20;
+	const static size_t maxBlocksPerClass = 32;
+	const static size_t maxCachedParts = 1 << 22;
+
+	/// Plain data, so that reaching the free lists of a thread needs no initialization check.
+	struct FreeLists
+	{
+		unsigned int* blocks[numberOfClasses][maxBlocksPerClass];
+		size_t blockCount[numberOfClasses];
+		size_t cachedParts;
+		bool registered;
+		bool destroyed;
+	};
+
+	/// Frees the cached blocks when its thread exits.
+	struct FreeListsOwner
+	{
+		bool active;
+
+		~FreeListsOwner();
+	};
+
+	static thread_local FreeLists freeLists;
+	static thread_local FreeListsOwner freeListsOwner;
+
+	static size_t sizeClass(size_t);
+
+public:
+	struct Statistics
+	{
+		size_t hits;
+		size_t misses;
+		size_t releases;
+	};
+
+	/// Returns a block of at least capacity limbs; capacity is updated to the real size.
+	static unsigned int* allocate(size_t&);
+	static void release(unsigned int*, size_t);
+
+	/// Counters of the calling thread.
+	static Statistics statistics();
+	static void resetStatistics();
+};
+
+/// Zeroed scratch limbs taken from LimbAllocator for the length of a scope.
+class LimbBuffer
+{
+private:
+	unsigned int* block;
+	size_t capacity;
+
+public:
+	LimbBuffer(size_t);
+	LimbBuffer(const LimbBuffer&) = delete;
+	LimbBuffer& operator=(const LimbBuffer&) = delete;
+	~LimbBuffer();
+
+	unsigned int* data();
+	unsigned int& operator[](size_t);
+};
\ No newline at end of file
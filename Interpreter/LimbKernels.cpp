@@ -0,0 +1,373 @@
+#include "LimbKernels.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define LIMB_KERNELS_TARGET(x)
+#else
+#include <cpuid.h>
+#define LIMB_KERNELS_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
+
+LimbKernels::CarryKernel LimbKernels::add = LimbKernels::addScalar;
+LimbKernels::CarryKernel LimbKernels::subtract = LimbKernels::subtractScalar;
+LimbKernels::CompareKernel LimbKernels::compare = LimbKernels::compareScalar;
+LimbKernels::EqualKernel LimbKernels::equal = LimbKernels::equalScalar;
+const char* LimbKernels::selectedInstructionSet = "scalar";
+
+static const bool kernelsSelected = (LimbKernels::selectKernels(), true);
+
+void LimbKernels::selectKernels()
+{
+	if (!useKernels("avx2") && !useKernels("sse4.2")) useScalarKernels();
+}
+
+void LimbKernels::useScalarKernels()
+{
+	add = addScalar;
+	subtract = subtractScalar;
+	compare = compareScalar;
+	equal = equalScalar;
+	selectedInstructionSet = "scalar";
+}
+
+bool LimbKernels::useKernels(const char* name)
+{
+	if (std::strcmp(name, "scalar") == 0)
+	{
+		useScalarKernels();
+		return true;
+	}
+
+#if defined(_M_X64) || defined(__x86_64__)
+	if (std::strcmp(name, "avx2") == 0 && cpuSupportsAvx2())
+	{
+		add = addAvx2;
+		subtract = subtractAvx2;
+		compare = compareAvx2;
+		equal = equalAvx2;
+		selectedInstructionSet = "avx2";
+		return true;
+	}
+	if (std::strcmp(name, "sse4.2") == 0 && cpuSupportsSse42())
+	{
+		add = addSse42;
+		subtract = subtractSse42;
+		compare = compareSse42;
+		equal = equalSse42;
+		selectedInstructionSet = "sse4.2";
+		return true;
+	}
+#endif
+
+	return false;
+}
+
+const char* LimbKernels::instructionSet()
+{
+	return selectedInstructionSet;
+}
+
+unsigned int LimbKernels::addScalar(unsigned int* result, const unsigned int* first, const unsigned int* second, size_t size)
+{
+	unsigned long long int sum, carry = 0;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		sum = (unsigned long long int)first[i] + second[i] + carry;
+		result[i] = (unsigned int)sum;
+		carry = sum >> 32;
+	}
+
+	return (unsigned int)carry;
+}
+
+unsigned int LimbKernels::subtractScalar(unsigned int* result, const unsigned int* first, const unsigned int* second, size_t size)
+{
+	unsigned long long int difference, borrow = 0;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		difference = (unsigned long long int)first[i] - second[i] - borrow;
+		result[i] = (unsigned int)difference;
+		borrow = (difference >> 32) & 1;
+	}
+
+	return (unsigned int)borrow;
+}
+
+int LimbKernels::compareScalar(const unsigned int* first, const unsigned int* second, size_t size)
+{
+	for (size_t i = size; i > 0; i--)
+	{
+		if (first[i - 1] != second[i - 1]) return first[i - 1] < second[i - 1] ? -1 : 1;
+	}
+	return 0;
+}
+
+bool LimbKernels::equalScalar(const unsigned int* first, const unsigned int* second, size_t size)
+{
+	return std::equal(first, first + size, second);
+}
+
+#if defined(_M_X64) || defined(__x86_64__)
+
+/// The vector kernels work on blocks of limbs. Per block every lane reports whether it
+/// generates a carry (borrow) by itself and whether it would propagate an incoming one.
+/// With these as bit masks g and p the carries into all lanes are ((g << 1 | c) + p) ^ p,
+/// the bit just above the last lane being the carry out of the block.
+
+static void cpuid(int leaf, int subleaf, unsigned int registers[4])
+{
+#if defined(_MSC_VER)
+	int values[4];
+	__cpuidex(values, leaf, subleaf);
+	for (int i = 0; i < 4; i++) registers[i] = (unsigned int)values[i];
+#else
+	__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+static unsigned long long int enabledStateComponents()
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	unsigned int low, high;
+	__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+	return ((unsigned long long int)high << 32) | low;
+#endif
+}
+
+bool LimbKernels::cpuSupportsSse42()
+{
+	unsigned int registers[4];
+
+	cpuid(0, 0, registers);
+	if (registers[0] < 1) return false;
+
+	cpuid(1, 0, registers);
+	return (registers[2] >> 20) & 1;
+}
+
+bool LimbKernels::cpuSupportsAvx2()
+{
+	unsigned int registers[4];
+
+	cpuid(0, 0, registers);
+	if (registers[0] < 7) return false;
+
+	cpuid(1, 0, registers);
+	if (((registers[2] >> 27) & 1) == 0 || ((registers[2] >> 28) & 1) == 0) return false;
+	if ((enabledStateComponents() & 6) != 6) return false;
+
+	cpuid(7, 0, registers);
+	return (registers[1] >> 5) & 1;
+}
+
+LIMB_KERNELS_TARGET("sse4.2")
+unsigned int LimbKernels::addSse42(unsigned int* result, const unsigned int* first, const unsigned int* second, size_t size)
+{
+	const __m128i lanes = _mm_setr_epi32(1, 2, 4, 8);
+	const __m128i ones = _mm_set1_epi32(-1);
+	unsigned int carry = 0, generate, propagate, carries;
+	size_t i;
+
+	for (i = 0; i + 4 <= size; i += 4)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(first + i));
+		__m128i b = _mm_loadu_si128((const __m128i*)(second + i));
+		__m128i sum = _mm_add_epi32(a, b);
+
+		generate = ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_max_epu32(sum, a), sum))) & 0xF;
+		propagate = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(sum, ones)));
+		carries = (((generate << 1) | carry) + propagate) ^ propagate;
+
+		__m128i carryMask = _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(carries), lanes), lanes);
+		_mm_storeu_si128((__m128i*)(result + i), _mm_sub_epi32(sum, carryMask));
+		carry = (carries >> 4) & 1;
+	}
+
+	unsigned long long int sum;
+	for (; i < size; i++)
+	{
+		sum = (unsigned long long int)first[i] + second[i] + carry;
+		result[i] = (unsigned int)sum;
+		carry = (unsigned int)(sum >> 32);
+	}
+
+	return carry;
+}
+
+LIMB_KERNELS_TARGET("sse4.2")
+unsigned int LimbKernels::subtractSse42(unsigned int* result, const unsigned int* first, const unsigned int* second, size_t size)
+{
+	const __m128i lanes = _mm_setr_epi32(1, 2, 4, 8);
+	const __m128i zero = _mm_setzero_si128();
+	unsigned int borrow = 0, generate, propagate, borrows;
+	size_t i;
+
+	for (i = 0; i + 4 <= size; i += 4)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(first + i));
+		__m128i b = _mm_loadu_si128((const __m128i*)(second + i));
+		__m128i difference = _mm_sub_epi32(a, b);
+
+		generate = ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_max_epu32(a, b), a))) & 0xF;
+		propagate = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(difference, zero)));
+		borrows = (((generate << 1) | borrow) + propagate) ^ propagate;
+
+		__m128i borrowMask = _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(borrows), lanes), lanes);
+		_mm_storeu_si128((__m128i*)(result + i), _mm_add_epi32(difference, borrowMask));
+		borrow = (borrows >> 4) & 1;
+	}
+
+	unsigned long long int difference;
+	for (; i < size; i++)
+	{
+		difference = (unsigned long long int)first[i] - second[i] - borrow;
+		result[i] = (unsigned int)difference;
+		borrow = (unsigned int)(difference >> 32) & 1;
+	}
+
+	return borrow;
+}
+
+LIMB_KERNELS_TARGET("sse4.2")
+int LimbKernels::compareSse42(const unsigned int* first, const unsigned int* second, size_t size)
+{
+	size_t i = size;
+	unsigned int equalLanes;
+
+	for (; i >= 4; i -= 4)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(first + i - 4));
+		__m128i b = _mm_loadu_si128((const __m128i*)(second + i - 4));
+
+		equalLanes = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b)));
+		if (equalLanes != 0xF) return compareScalar(first + i - 4, second + i - 4, 4);
+	}
+
+	return compareScalar(first, second, i);
+}
+
+LIMB_KERNELS_TARGET("sse4.2")
+bool LimbKernels::equalSse42(const unsigned int* first, const unsigned int* second, size_t size)
+{
+	size_t i;
+
+	for (i = 0; i + 4 <= size; i += 4)
+	{
+		__m128i difference = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(first + i)), _mm_loadu_si128((const __m128i*)(second + i)));
+		if (!_mm_testz_si128(difference, difference)) return false;
+	}
+
+	return std::equal(first + i, first + size, second + i);
+}
+
+LIMB_KERNELS_TARGET("avx2")
+unsigned int LimbKernels::addAvx2(unsigned int* result, const unsigned int* first, const unsigned int* second, size_t size)
+{
+	const __m256i lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+	const __m256i ones = _mm256_set1_epi32(-1);
+	unsigned int carry = 0, generate, propagate, carries;
+	size_t i;
+
+	for (i = 0; i + 8 <= size; i += 8)
+	{
+		__m256i a = _mm256_loadu_si256((const __m256i*)(first + i));
+		__m256i b = _mm256_loadu_si256((const __m256i*)(second + i));
+		__m256i sum = _mm256_add_epi32(a, b);
+
+		generate = ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_max_epu32(sum, a), sum))) & 0xFF;
+		propagate = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(sum, ones)));
+		carries = (((generate << 1) | carry) + propagate) ^ propagate;
+
+		__m256i carryMask = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(carries), lanes), lanes);
+		_mm256_storeu_si256((__m256i*)(result + i), _mm256_sub_epi32(sum, carryMask));
+		carry = (carries >> 8) & 1;
+	}
+
+	unsigned long long int sum;
+	for (; i < size; i++)
+	{
+		sum = (unsigned long long int)first[i] + second[i] + carry;
+		result[i] = (unsigned int)sum;
+		carry = (unsigned int)(sum >> 32);
+	}
+
+	return carry;
+}
+
+LIMB_KERNELS_TARGET("avx2")
+unsigned int LimbKernels::subtractAvx2(unsigned int* result, const unsigned int* first, const unsigned int* second, size_t size)
+{
+	const __m256i lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+	const __m256i zero = _mm256_setzero_si256();
+	unsigned int borrow = 0, generate, propagate, borrows;
+	size_t i;
+
+	for (i = 0; i + 8 <= size; i += 8)
+	{
+		__m256i a = _mm256_loadu_si256((const __m256i*)(first + i));
+		__m256i b = _mm256_loadu_si256((const __m256i*)(second + i));
+		__m256i difference = _mm256_sub_epi32(a, b);
+
+		generate = ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_max_epu32(a, b), a))) & 0xFF;
+		propagate = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(difference, zero)));
+		borrows = (((generate << 1) | borrow) + propagate) ^ propagate;
+
+		__m256i borrowMask = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(borrows), lanes), lanes);
+		_mm256_storeu_si256((__m256i*)(result + i), _mm256_add_epi32(difference, borrowMask));
+		borrow = (borrows >> 8) & 1;
+	}
+
+	unsigned long long int difference;
+	for (; i < size; i++)
+	{
+		difference = (unsigned long long int)first[i] - second[i] - borrow;
+		result[i] = (unsigned int)difference;
+		borrow = (unsigned int)(difference >> 32) & 1;
+	}
+
+	return borrow;
+}
+
+LIMB_KERNELS_TARGET("avx2")
+int LimbKernels::compareAvx2(const unsigned int* first, const unsigned int* second, size_t size)
+{
+	size_t i = size;
+	unsigned int equalLanes;
+
+	for (; i >= 8; i -= 8)
+	{
+		__m256i a = _mm256_loadu_si256((const __m256i*)(first + i - 8));
+		__m256i b = _mm256_loadu_si256((const __m256i*)(second + i - 8));
+
+		equalLanes = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)));
+		if (equalLanes != 0xFF) return compareScalar(first + i - 8, second + i - 8, 8);
+	}
+
+	return compareScalar(first, second, i);
+}
+
+LIMB_KERNELS_TARGET("avx2")
+bool LimbKernels::equalAvx2(const unsigned int* first, const unsigned int* second, size_t size)
+{
+	size_t i;
+
+	for (i = 0; i + 8 <= size; i += 8)
+	{
+		__m256i difference = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(first + i)), _mm256_loadu_si256((const __m256i*)(second + i)));
+		if (!_mm256_testz_si256(difference, difference)) return false;
+	}
+
+	return std::equal(first + i, first + size, second + i);
+}
+
+#endif
\ No newline at end of file
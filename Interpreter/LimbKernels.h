@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+
+/// Limb-level loops shared by the Number arithmetic. The vector versions are
+/// selected once at startup from CPUID; every kernel has a scalar fallback.
+class LimbKernels
+{
+private:
+	static const char* selectedInstructionSet;
+
+	static unsigned int addScalar(unsigned int*, const unsigned int*, const unsigned int*, size_t);
+	static unsigned int subtractScalar(unsigned int*, const unsigned int*, const unsigned int*, size_t);
+	static int compareScalar(const unsigned int*, const unsigned int*, size_t);
+	static bool equalScalar(const unsigned int*, const unsigned int*, size_t);
+
+#if defined(_M_X64) || defined(__x86_64__)
+	static bool cpuSupportsSse42();
+	static bool cpuSupportsAvx2();
+
+	static unsigned int addSse42(unsigned int*, const unsigned int*, const unsigned int*, size_t);
+	static unsigned int subtractSse42(unsigned int*, const unsigned int*, const unsigned int*, size_t);
+	static int compareSse42(const unsigned int*, const unsigned int*, size_t);
+	static bool equalSse42(const unsigned int*, const unsigned int*, size_t);
+
+	static unsigned int addAvx2(unsigned int*, const unsigned int*, const unsigned int*, size_t);
+	static unsigned int subtractAvx2(unsigned int*, const unsigned int*, const unsigned int*, size_t);
+	static int compareAvx2(const unsigned int*, const unsigned int*, size_t);
+	static bool equalAvx2(const unsigned int*, const unsigned int*, size_t);
+#endif
+
+public:
+	/// result = first + second (or first - second) over size limbs, returns the carry (borrow).
+	/// result may be the same array as first.
+	typedef unsigned int (*CarryKernel)(unsigned int*, const unsigned int*, const unsigned int*, size_t);
+	/// Compares two arrays of size limbs from the most significant one, returns -1, 0 or 1.
+	typedef int (*CompareKernel)(const unsigned int*, const unsigned int*, size_t);
+	typedef bool (*EqualKernel)(const unsigned int*, const unsigned int*, size_t);
+
+	static CarryKernel add;
+	static CarryKernel subtract;
+	static CompareKernel compare;
+	static EqualKernel equal;
+
+	static void selectKernels();
+	static void useScalarKernels();
+	/// Forces the "scalar", "sse4.2" or "avx2" kernels, false if the CPU (or build) lacks them.
+	static bool useKernels(const char* name);
+	static const char* instructionSet();
+};
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include "LoopOptimizer.h"
+
+#include <utility>
+
+LoopOptimizer::LoopOptimizer()
+{
+	loops = 0;
+}
+
+void LoopOptimizer::collectAssigned(const Instruction& Ins, std::multiset<int>& assigned)
+{
+	switch (Ins.type)
+	{
+	case Instruction::variableDefinitionType:
+	case Instruction::readType:
+	case Instruction::counterStepType:
+		assigned.insert(Ins.parameters[0].slot);
+		return;
+	case Instruction::functionDefinitionType:
+	case Instruction::recursiveFunctionDefinitionType:
+		/// Assignments in a function body are local to its calls
+		return;
+	default:
+		break;
+	}
+
+	for (size_t i = 0; i < Ins.parameters.size(); i++) collectAssigned(Ins.parameters[i], assigned);
+}
+
+bool LoopOptimizer::isInvariant(const Instruction& Ins, const std::multiset<int>& assigned, bool& readsVariable)
+{
+	switch (Ins.type)
+	{
+	case Instruction::numberType:
+		return true;
+	case Instruction::variableNameType:
+		readsVariable = true;
+		return assigned.count(Ins.slot) == 0;
+	case Instruction::invariantType:
+		readsVariable = true;
+		return true;
+	case Instruction::arithmeticType:
+		return isInvariant(Ins.parameters[0], assigned, readsVariable) && isInvariant(Ins.parameters[1], assigned, readsVariable);
+	default:
+		return false;
+	}
+}
+
+void LoopOptimizer::wrapInvariants(Instruction& Ins, const std::multiset<int>& assigned, int& loop)
+{
+	switch (Ins.type)
+	{
+	case Instruction::arithmeticType:
+	{
+		bool readsVariable = false;
+		if (!isInvariant(Ins, assigned, readsVariable) || !readsVariable) break;
+
+		if (loop < 0) loop = loops++;
+
+		Instruction invariant(Instruction::invariantType);
+		invariant.cacheEntry = invariantLoops.size();
+		invariant.parameters.push_back(std::move(Ins));
+		Ins = std::move(invariant);
+		invariantLoops.push_back(loop);
+		return;
+	}
+	case Instruction::invariantType:
+	case Instruction::functionDefinitionType:
+	case Instruction::recursiveFunctionDefinitionType:
+		return;
+	default:
+		break;
+	}
+
+	for (size_t i = 0; i < Ins.parameters.size(); i++) wrapInvariants(Ins.parameters[i], assigned, loop);
+}
+
+void LoopOptimizer::recognizeCountedLoop(Instruction& loop, const std::multiset<int>& assigned)
+{
+	const Instruction& cond = loop.parameters[0];
+	if (cond.type != Instruction::booleanType || cond.operation != '<') return;
+	if (cond.parameters[0].type != Instruction::variableNameType) return;
+
+	int counter = cond.parameters[0].slot;
+	const Instruction& bound = cond.parameters[1];
+	if (assigned.count(counter) != 1) return;
+	if (bound.type == Instruction::variableNameType && assigned.count(bound.slot) != 0) return;
+	if (bound.type != Instruction::variableNameType && bound.type != Instruction::numberType && bound.type != Instruction::invariantType) return;
+
+	std::vector<Instruction>& body = loop.parameters[1].parameters;
+	for (size_t i = 0; i < body.size(); i++)
+	{
+		Instruction& statement = body[i];
+		if (statement.type != Instruction::variableDefinitionType || statement.parameters[0].slot != counter) continue;
+
+		Instruction& value = statement.parameters[1];
+		if (value.type != Instruction::arithmeticType || value.operation != '+') return;
+		if (value.parameters[0].type != Instruction::variableNameType || value.parameters[0].slot != counter) return;
+		if (value.parameters[1].type != Instruction::numberType) return;
+
+		Instruction step(Instruction::counterStepType);
+		step.parameters.push_back(std::move(statement.parameters[0]));
+		step.parameters.push_back(std::move(value.parameters[1]));
+		statement = std::move(step);
+
+		loop.type = Instruction::countedWhileType;
+		return;
+	}
+}
+
+void LoopOptimizer::optimizeLoop(Instruction& loop)
+{
+	std::multiset<int> assigned;
+	collectAssigned(loop.parameters[1], assigned);
+
+	if (!loop.containsCall())
+	{
+		int index = -1;
+		wrapInvariants(loop.parameters[0], assigned, index);
+		wrapInvariants(loop.parameters[1], assigned, index);
+		loop.loop = index;
+	}
+
+	recognizeCountedLoop(loop, assigned);
+	optimizeStatements(loop.parameters[1]);
+}
+
+void LoopOptimizer::optimizeStatements(Instruction& Ins)
+{
+	switch (Ins.type)
+	{
+	case Instruction::sequenceType:
+		for (size_t i = 0; i < Ins.parameters.size(); i++) optimizeStatements(Ins.parameters[i]);
+		break;
+	case Instruction::ifStatementType:
+		optimizeStatements(Ins.parameters[1]);
+		optimizeStatements(Ins.parameters[2]);
+		break;
+	case Instruction::whileStatementType:
+		optimizeLoop(Ins);
+		break;
+	case Instruction::recursiveFunctionDefinitionType:
+		optimizeStatements(Ins.parameters[2]);
+		break;
+	default:
+		break;
+	}
+}
+
+void LoopOptimizer::optimize(Instruction& mainSequence, int& loops, std::vector<int>& invariantLoops)
+{
+	LoopOptimizer optimizer;
+	optimizer.optimizeStatements(mainSequence);
+
+	loops = optimizer.loops;
+	invariantLoops.swap(optimizer.invariantLoops);
+}
\ No newline at end of file
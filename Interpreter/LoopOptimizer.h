@@ -0,0 +1,38 @@
+#pragma once
+
+#include <set>
+#include <vector>
+
+#include "Instruction.h"
+
+/// Analysis of while loops, run after Optimizer.
+///
+/// Subexpressions of a loop whose variables are not assigned in its body are
+/// wrapped in invariant nodes: they are still evaluated where they first run, so
+/// errors appear at the same point, and their value is reused until the loop is
+/// started again. Only loops without function calls cache invariants, a call
+/// could enter the same loop again before it finishes.
+///
+/// Loops of the form (i < bound) with a single i = i + c in their body and a
+/// bound that does not change become counted loops, which test and step the
+/// counter in place.
+class LoopOptimizer
+{
+private:
+	int loops;
+	/// Loop index of every invariant cache entry
+	std::vector<int> invariantLoops;
+
+	LoopOptimizer();
+
+	static void collectAssigned(const Instruction&, std::multiset<int>&);
+	static bool isInvariant(const Instruction&, const std::multiset<int>&, bool& readsVariable);
+
+	void wrapInvariants(Instruction&, const std::multiset<int>&, int& loop);
+	void recognizeCountedLoop(Instruction&, const std::multiset<int>&);
+	void optimizeLoop(Instruction&);
+	void optimizeStatements(Instruction&);
+
+public:
+	static void optimize(Instruction& mainSequence, int& loops, std::vector<int>& invariantLoops);
+};
\ No newline at end of file
@@ -0,0 +1,38 @@
+#include "MemoCache.h"
+
+MemoCache::MemoCache()
+{
+	storedParts = 0;
+	hits = 0;
+	misses = 0;
+}
+
+const Number* MemoCache::find(const Number& argument)
+{
+	std::map<Number, Number>::const_iterator it = results.find(argument);
+
+	if (it == results.end())
+	{
+		misses++;
+		return nullptr;
+	}
+	hits++;
+	return &it->second;
+}
+
+void MemoCache::insert(const Number& argument, const Number& result)
+{
+	size_t parts = argument.numberOfParts() + result.numberOfParts();
+	if (results.size() >= maxEntries || storedParts + parts > maxParts) return;
+
+	if (results.insert(std::make_pair(argument, result)).second) storedParts += parts;
+}
+
+MemoCache::Statistics MemoCache::statistics() const
+{
+	Statistics current;
+	current.hits = hits;
+	current.misses = misses;
+	current.entries = results.size();
+	return current;
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <map>
+
+#include "Number.h"
+
+/// Results of a pure function by argument. The cache stops accepting results once
+/// it holds maxEntries of them or maxParts limbs in total.
+class MemoCache
+{
+private:
+	const static size_t maxEntries = 1 << 16;
+	const static size_t maxParts = 1 << 22;
+
+	std::map<Number, Number> results;
+	size_t storedParts;
+	size_t hits;
+	size_t misses;
+
+public:
+	struct Statistics
+	{
+		size_t hits;
+		size_t misses;
+		size_t entries;
+	};
+
+	MemoCache();
+
+	/// Returns the stored result for the argument or nullptr.
+	const Number* find(const Number&);
+	void insert(const Number& argument, const Number& result);
+
+	Statistics statistics() const;
+};
\ No newline at end of file
@@ -1,253 +1,1024 @@
 #include "Number.h"
+#include "LimbAllocator.h"
+#include "LimbKernels.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+size_t Number::parallelMultiplicationThreshold = 20000;
+unsigned int Number::multiplicationThreads = std::max(1u, std::thread::hardware_concurrency());
+std::unique_ptr<ThreadPool> Number::multiplicationPool;
+static std::mutex multiplicationPoolMutex;
 
 void Number::copyData(const Number& other)
 {
-	parts.resize(other.numberOfParts());
-	for (size_t i = 0; i < other.numberOfParts(); i++) parts[i] = other.parts[i];
+	assignParts(other.parts, other.numberOfParts());
 }
 
 void Number::simplifyNumber()
 {
-	while (numberOfParts() > 1 && parts.back() == 0) parts.pop_back();
+	while (partsSize > 1 && parts[partsSize - 1] == 0) partsSize--;
+}
+
+void Number::reserveParts(size_t capacity)
+{
+	if (capacity <= partsCapacity) return;
+
+	capacity = std::max(capacity, 2 * partsCapacity);
+	unsigned int* newParts = LimbAllocator::allocate(capacity);
+	std::copy(parts, parts + partsSize, newParts);
+
+	if (parts != localParts) LimbAllocator::release(parts, partsCapacity);
+	parts = newParts;
+	partsCapacity = capacity;
+}
+
+void Number::resizeParts(size_t size)
+{
+	reserveParts(size);
+	if (size > partsSize) std::fill(parts + partsSize, parts + size, 0);
+	partsSize = size;
+}
+
+void Number::assignParts(const unsigned int* source, size_t size)
+{
+	partsSize = 0;
+	reserveParts(size);
+	std::copy(source, source + size, parts);
+	partsSize = size;
+}
+
+void Number::appendPart(unsigned int part)
+{
+	reserveParts(partsSize + 1);
+	parts[partsSize++] = part;
+}
+
+void Number::swapParts(Number& other)
+{
+	bool thisLocal = (parts == localParts), otherLocal = (other.parts == other.localParts);
+
+	std::swap_ranges(localParts, localParts + localCapacity, other.localParts);
+	std::swap(parts, other.parts);
+	std::swap(partsSize, other.partsSize);
+	std::swap(partsCapacity, other.partsCapacity);
+
+	if (otherLocal) parts = localParts;
+	if (thisLocal) other.parts = other.localParts;
+}
+
+bool Number::equalParts(const Number& other) const
+{
+	return partsSize == other.partsSize && LimbKernels::equal(parts, other.parts, partsSize);
 }
 
-void Number::multiplyByBase()
+void Number::multiplyAddSmall(unsigned int multiplier, unsigned int addend)
 {
-	unsigned long long int current, carry = 0;
+	unsigned long long int current, carry = addend;
 
 	for (size_t i = 0; i < numberOfParts(); i++)
 	{
-		current = parts[i];
-		current *= base;
-		current += carry;
+		current = (unsigned long long int)parts[i] * multiplier + carry;
+		parts[i] = (unsigned int)current;
+		carry = current >> partBits;
+	}
 
-		carry = current / basePowerLimit;
+	if (carry > 0) appendPart((unsigned int)carry);
+}
 
-		parts[i] = current % basePowerLimit;
-	}
+void Number::extendParts(size_t numberOfExtraParts)
+{
+	if (isZero() || numberOfExtraParts == 0) return;
 
-	if (carry > 0) parts.push_back(carry);
+	size_t len = numberOfParts();
+	resizeParts(len + numberOfExtraParts);
+	std::copy_backward(parts, parts + len, parts + len + numberOfExtraParts);
+	std::fill(parts, parts + numberOfExtraParts, 0);
 }
 
-void Number::divideByBase()
+void Number::shiftLeftBits(size_t bits)
 {
-	unsigned long long int current, carry = 0, multiplier = basePowerLimit / base;
+	size_t partShift = bits / partBits, len = numberOfParts();
+	unsigned int bitShift = bits % partBits;
+
+	if (isZero() || bits == 0) return;
 
-	for (int i = numberOfParts() - 1; i >= 0; i--)
+	resizeParts(len + partShift + 1);
+	for (size_t i = len + partShift; i > partShift; i--)
 	{
-		current = parts[i] / base;
-		current += carry * multiplier;
+		parts[i] = (bitShift ? parts[i - partShift - 1] >> (partBits - bitShift) : 0) | (i - partShift < len ? parts[i - partShift] << bitShift : 0);
+	}
+	parts[partShift] = parts[0] << bitShift;
+	std::fill(parts, parts + partShift, 0);
 
-		carry = parts[i] % base;
+	simplifyNumber();
+}
 
-		parts[i] = current;
+void Number::shiftRightBits(size_t bits)
+{
+	size_t partShift = bits / partBits, len = numberOfParts();
+	unsigned int bitShift = bits % partBits;
+
+	if (partShift >= len)
+	{
+		partsSize = 1;
+		parts[0] = 0;
+		return;
+	}
+
+	for (size_t i = 0; i + partShift < len; i++)
+	{
+		parts[i] = (parts[i + partShift] >> bitShift) | (bitShift && i + partShift + 1 < len ? parts[i + partShift + 1] << (partBits - bitShift) : 0);
 	}
+	partsSize = len - partShift;
 
 	simplifyNumber();
 }
 
-void Number::extendParts(size_t numberOfExtraParts)
+size_t Number::numberOfParts() const
 {
-	size_t len = numberOfParts();
-	parts.resize(numberOfExtraParts + len);
-	for (int i = len - 1; i >= 0; i--) parts[numberOfExtraParts + i] = parts[i];
-	for (size_t i = 0; i < numberOfExtraParts; i++) parts[i] = 0;
+	return partsSize;
 }
 
-size_t Number::numberOfParts() const
+Number Number::fromParts(const unsigned int* source, size_t size)
 {
-	return parts.size();
+	Number result;
+	if (size == 0) return result;
+
+	result.assignParts(source, size);
+	result.simplifyNumber();
+	return result;
 }
 
-Number::Number(unsigned int x)
+Number Number::partsRange(const Number& num, size_t begin, size_t count)
 {
-	parts.push_back(x);
+	if (begin >= num.numberOfParts()) return Number(0);
+	return fromParts(num.parts + begin, std::min(count, num.numberOfParts() - begin));
 }
 
-Number::Number(const std::string& s)
+void Number::addSigned(Number& first, bool& firstNegative, const Number& second, bool secondNegative)
+{
+	if (firstNegative == secondNegative) first += second;
+	else if (first < second)
+	{
+		subtract(second, first, first);
+		firstNegative = secondNegative;
+	}
+	else first -= second;
+
+	if (first.isZero()) firstNegative = false;
+}
+
+unsigned int Number::divideBySmall(Number& num, unsigned int divider)
 {
-	unsigned int number = 0;
-	unsigned int multiplier = 1;
+	unsigned long long int current, remainder = 0;
 
-	for (int i = s.size() - 1; i >= 0; i--)
+	for (int i = num.numberOfParts() - 1; i >= 0; i--)
 	{
-		number += multiplier * (s[i] - '0');
-		multiplier *= base;
+		current = (remainder << partBits) | num.parts[i];
+		num.parts[i] = (unsigned int)(current / divider);
+		remainder = current % divider;
+	}
+
+	num.simplifyNumber();
+	return (unsigned int)remainder;
+}
+
+void Number::divideKnuth(const Number& dividend, const Number& divider, Number& quotient, Number& remainder)
+{
+	size_t dividerSize = divider.numberOfParts(), dividendSize = dividend.numberOfParts();
+	size_t quotientSize = dividendSize - dividerSize + 1;
+	unsigned int shift = 0;
+
+	while (((divider.parts[dividerSize - 1] << shift) >> (partBits - 1)) == 0) shift++;
+
+	LimbBuffer v(dividerSize), u(dividendSize + 1);
+	for (size_t i = dividerSize - 1; i > 0; i--)
+	{
+		v[i] = (divider.parts[i] << shift) | (shift ? divider.parts[i - 1] >> (partBits - shift) : 0);
+	}
+	v[0] = divider.parts[0] << shift;
+
+	u[dividendSize] = shift ? dividend.parts[dividendSize - 1] >> (partBits - shift) : 0;
+	for (size_t i = dividendSize - 1; i > 0; i--)
+	{
+		u[i] = (dividend.parts[i] << shift) | (shift ? dividend.parts[i - 1] >> (partBits - shift) : 0);
+	}
+	u[0] = dividend.parts[0] << shift;
+
+	const unsigned long long int partMask = 0xFFFFFFFFULL;
+	unsigned long long int top = v[dividerSize - 1], second = v[dividerSize - 2];
+	unsigned long long int numerator, estimate, estimateRemainder, product, carry, difference, borrow;
 
-		if (multiplier >= basePowerLimit)
+	quotient.resizeParts(quotientSize);
+
+	for (int j = quotientSize - 1; j >= 0; j--)
+	{
+		numerator = ((unsigned long long int)u[j + dividerSize] << partBits) | u[j + dividerSize - 1];
+		estimate = numerator / top;
+		estimateRemainder = numerator % top;
+
+		while (estimate > partMask || estimate * second > ((estimateRemainder << partBits) | u[j + dividerSize - 2]))
+		{
+			estimate--;
+			estimateRemainder += top;
+			if (estimateRemainder > partMask) break;
+		}
+
+		carry = 0;
+		borrow = 0;
+		for (size_t i = 0; i < dividerSize; i++)
 		{
-			parts.push_back(number);
-			number = 0;
-			multiplier = 1;
+			product = estimate * v[i] + carry;
+			carry = product >> partBits;
+			difference = (unsigned long long int)u[i + j] - (product & partMask) - borrow;
+			u[i + j] = (unsigned int)difference;
+			borrow = (difference >> partBits) & 1;
 		}
+		difference = (unsigned long long int)u[j + dividerSize] - carry - borrow;
+		u[j + dividerSize] = (unsigned int)difference;
+
+		if (difference >> (2 * partBits - 1))
+		{
+			estimate--;
+			u[j + dividerSize] += addParts(u.data() + j, u.data() + j, dividerSize, v.data(), dividerSize);
+		}
+
+		quotient.parts[j] = (unsigned int)estimate;
 	}
 
-	parts.push_back(number);
-	simplifyNumber();
+	quotient.simplifyNumber();
+
+	remainder.resizeParts(dividerSize);
+	for (size_t i = 0; i + 1 < dividerSize; i++)
+	{
+		remainder.parts[i] = (u[i] >> shift) | (shift ? u[i + 1] << (partBits - shift) : 0);
+	}
+	remainder.parts[dividerSize - 1] = u[dividerSize - 1] >> shift;
+	remainder.simplifyNumber();
 }
 
-Number::Number(const Number& other)
+void Number::divideThreeHalves(const Number& dividend, const Number& divider, Number& quotient, Number& remainder)
 {
-	copyData(other);
+	size_t half = divider.numberOfParts() / 2;
+	Number dividerHigh = partsRange(divider, half, half), dividerLow = partsRange(divider, 0, half);
+	Number dividendHigh = partsRange(dividend, half, dividend.numberOfParts()), current;
+
+	if (partsRange(dividend, 2 * half, dividend.numberOfParts()) < dividerHigh) divideRecursive(dividendHigh, dividerHigh, quotient, current);
+	else
+	{
+		Number shiftedDivider = dividerHigh;
+		shiftedDivider.extendParts(half);
+
+		quotient.resizeParts(half);
+		std::fill(quotient.parts, quotient.parts + half, 0xFFFFFFFFu);
+		add(dividendHigh, dividerHigh, current);
+		current -= shiftedDivider;
+	}
+
+	Number product = quotient * dividerLow;
+	current.extendParts(half);
+	current += partsRange(dividend, 0, half);
+
+	while (current < product)
+	{
+		current += divider;
+		quotient -= Number(1);
+	}
+
+	subtract(current, product, remainder);
 }
 
-Number& Number::operator=(const Number& other)
+void Number::divideRecursive(const Number& dividend, const Number& divider, Number& quotient, Number& remainder)
 {
-	if (this != &other)
+	size_t dividerSize = divider.numberOfParts();
+
+	if (dividerSize % 2 == 1 || dividerSize < burnikelZieglerThreshold)
 	{
-		parts.clear();
-		copyData(other);
+		if (dividend < divider)
+		{
+			remainder = dividend;
+			quotient = Number(0);
+		}
+		else divideKnuth(dividend, divider, quotient, remainder);
+		return;
 	}
-	return *this;
+
+	size_t half = dividerSize / 2;
+	Number highQuotient, lowQuotient, current;
+
+	divideThreeHalves(partsRange(dividend, half, dividend.numberOfParts()), divider, highQuotient, current);
+	current.extendParts(half);
+	current += partsRange(dividend, 0, half);
+	divideThreeHalves(current, divider, lowQuotient, remainder);
+
+	highQuotient.extendParts(half);
+	highQuotient += lowQuotient;
+	quotient.swapParts(highQuotient);
 }
 
-Number Number::operator+(const Number& other) const
+void Number::divideBurnikelZiegler(const Number& dividend, const Number& divider, Number& quotient, Number& remainder)
 {
-	Number result;
-	result.parts.clear();
+	size_t dividerSize = divider.numberOfParts(), blockSize, blockCount, multiple = 1;
+	size_t shift;
+
+	while (dividerSize > multiple * burnikelZieglerThreshold) multiple *= 2;
+	blockSize = ((dividerSize + multiple - 1) / multiple) * multiple;
+
+	shift = (blockSize - dividerSize) * partBits;
+	while (((divider.parts[dividerSize - 1] << (shift % partBits)) >> (partBits - 1)) == 0) shift++;
+
+	Number normalizedDividend = dividend, normalizedDivider = divider;
+	normalizedDividend.shiftLeftBits(shift);
+	normalizedDivider.shiftLeftBits(shift);
+
+	blockCount = std::max((size_t)2, normalizedDividend.numberOfParts() / blockSize + 1);
 
-	size_t i = 0;
-	unsigned long long int sum;
-	unsigned long long int carry = 0, first, second;
+	Number current = partsRange(normalizedDividend, (blockCount - 2) * blockSize, 2 * blockSize);
+	Number blockQuotient, blockRemainder;
 
-	while (i < numberOfParts() || i < other.numberOfParts())
+	quotient.partsSize = 0;
+	quotient.resizeParts((blockCount - 1) * blockSize);
+
+	for (int i = blockCount - 2; i >= 0; i--)
 	{
-		if (i < numberOfParts()) first = parts[i];
-		else first = 0;
+		divideRecursive(current, normalizedDivider, blockQuotient, blockRemainder);
+		std::copy(blockQuotient.parts, blockQuotient.parts + blockQuotient.numberOfParts(), quotient.parts + i * blockSize);
+
+		if (i > 0)
+		{
+			blockRemainder.extendParts(blockSize);
+			blockRemainder += partsRange(normalizedDividend, (i - 1) * blockSize, blockSize);
+		}
+		current.swapParts(blockRemainder);
+	}
 
-		if (i < other.numberOfParts()) second = other.parts[i];
-		else second = 0;
+	quotient.simplifyNumber();
+	current.shiftRightBits(shift);
+	remainder.swapParts(current);
+}
+
+Number Number::parseDecimal(const char* digits, size_t length, std::vector<Number>& powers)
+{
+	size_t lowLength = decimalDigits, level = 0;
 
-		sum = first + second + carry;
+	if (length <= decimalConversionThreshold * decimalDigits)
+	{
+		Number result;
+		size_t chunkLength = length % decimalDigits;
+		if (chunkLength == 0) chunkLength = decimalDigits;
 
-		result.parts.push_back(sum % basePowerLimit);
-		carry = sum / basePowerLimit;
+		for (size_t i = 0; i < length; i += chunkLength, chunkLength = decimalDigits)
+		{
+			unsigned int chunk = 0, multiplier = 1;
+			for (size_t j = i; j < i + chunkLength; j++)
+			{
+				chunk = chunk * 10 + (digits[j] - '0');
+				multiplier *= 10;
+			}
+			result.multiplyAddSmall(multiplier, chunk);
+		}
 
-		i++;
+		result.simplifyNumber();
+		return result;
 	}
 
-	if (carry > 0) result.parts.push_back(carry);
+	while (2 * lowLength < length)
+	{
+		lowLength *= 2;
+		level++;
+	}
+	while (powers.size() <= level) powers.push_back(powers.empty() ? Number(decimalBase) : powers.back() * powers.back());
 
+	Number result = parseDecimal(digits, length - lowLength, powers);
+	result *= powers[level];
+	result += parseDecimal(digits + length - lowLength, lowLength, powers);
 	return result;
 }
 
-Number Number::operator-(const Number& other) const
+void Number::formatSmall(const Number& num, std::string& output, size_t width)
 {
-	if (*this < other) return 0;
+	Number current = num;
+	/// Every chunk takes more than 29 bits off the number
+	LimbBuffer chunks(num.numberOfParts() * partBits / 29 + 1);
+	size_t chunkCount = 0;
+	char digits[9];
+	size_t length;
+
+	if (num.isZero() && width > 0)
+	{
+		output.append(width, '0');
+		return;
+	}
 
-	Number result;
-	result.parts.resize(numberOfParts());
+	do
+	{
+		chunks[chunkCount++] = divideBySmall(current, decimalBase);
+	} while (!current.isZero());
 
-	unsigned long long int difference;
-	unsigned long long int carry = 0, first, second;
+	length = (chunkCount - 1) * decimalDigits;
+	for (unsigned int top = chunks[chunkCount - 1]; top > 0; top /= 10) length++;
+	if (length == 0) length = 1;
 
-	for (size_t i = 0; i < numberOfParts(); i++)
+	if (width > length) output.append(width - length, '0');
+
+	for (int i = chunkCount - 1; i >= 0; i--)
 	{
-		first = parts[i];
-		if (i < other.numberOfParts()) second = other.parts[i];
-		else second = 0;
-		second += carry;
+		unsigned int chunk = chunks[i];
+		for (int j = decimalDigits - 1; j >= 0; j--)
+		{
+			digits[j] = '0' + chunk % 10;
+			chunk /= 10;
+		}
 
-		if (second > first)
+		if (i == (int)chunkCount - 1) output.append(digits + decimalDigits - (length - i * decimalDigits), digits + decimalDigits);
+		else output.append(digits, digits + decimalDigits);
+	}
+}
+
+void Number::formatDecimal(const Number& num, std::string& output, size_t width, std::vector<Number>& powers)
+{
+	if (num.numberOfParts() <= decimalConversionThreshold)
+	{
+		formatSmall(num, output, width);
+		return;
+	}
+
+	size_t level = 0, lowLength = decimalDigits;
+	while (powers.size() <= level + 1 || 2 * powers[level + 1].numberOfParts() <= num.numberOfParts() + 1)
+	{
+		if (powers.size() <= level + 1)
 		{
-			carry = 1;
-			first += basePowerLimit;
+			powers.push_back(powers.empty() ? Number(decimalBase) : powers.back() * powers.back());
+			continue;
 		}
-		else carry = 0;
+		level++;
+		lowLength *= 2;
+	}
+
+	Number quotient, remainder;
+	num.divmod(powers[level], quotient, remainder);
+
+	formatDecimal(quotient, output, width > lowLength ? width - lowLength : 0, powers);
+	formatDecimal(remainder, output, lowLength, powers);
+}
 
-		difference = first - second;
+unsigned int Number::addParts(unsigned int* result, const unsigned int* first, size_t firstSize, const unsigned int* second, size_t secondSize)
+{
+	unsigned long long int sum, carry = LimbKernels::add(result, first, second, secondSize);
 
-		result.parts[i] = difference;
+	for (size_t i = secondSize; i < firstSize; i++)
+	{
+		sum = (unsigned long long int)first[i] + carry;
+		result[i] = (unsigned int)sum;
+		carry = sum >> partBits;
 	}
 
-	result.simplifyNumber();
-	return result;
+	return (unsigned int)carry;
 }
 
-Number Number::operator*(const Number& other) const
+unsigned int Number::subtractParts(unsigned int* result, const unsigned int* first, size_t firstSize, const unsigned int* second, size_t secondSize)
 {
-	Number result, temp;
-	unsigned long long int product, first, second;
+	unsigned long long int difference, borrow = LimbKernels::subtract(result, first, second, secondSize);
 
-	for (size_t i = 0; i < numberOfParts(); i++)
+	for (size_t i = secondSize; i < firstSize; i++)
 	{
-		for (size_t j = 0; j < other.numberOfParts(); j++)
+		difference = (unsigned long long int)first[i] - borrow;
+		result[i] = (unsigned int)difference;
+		borrow = (difference >> partBits) & 1;
+	}
+
+	return (unsigned int)borrow;
+}
+
+void Number::addIntoParts(unsigned int* result, size_t resultSize, const unsigned int* other, size_t otherSize)
+{
+	unsigned long long int sum, carry = LimbKernels::add(result, result, other, otherSize);
+
+	for (size_t i = otherSize; carry > 0 && i < resultSize; i++)
+	{
+		sum = (unsigned long long int)result[i] + carry;
+		result[i] = (unsigned int)sum;
+		carry = sum >> partBits;
+	}
+}
+
+void Number::subtractFromParts(unsigned int* result, size_t resultSize, const unsigned int* other, size_t otherSize)
+{
+	unsigned long long int difference, borrow = LimbKernels::subtract(result, result, other, otherSize);
+
+	for (size_t i = otherSize; borrow > 0 && i < resultSize; i++)
+	{
+		difference = (unsigned long long int)result[i] - borrow;
+		result[i] = (unsigned int)difference;
+		borrow = (difference >> partBits) & 1;
+	}
+}
+
+void Number::multiplySchoolbook(const unsigned int* first, size_t firstSize, const unsigned int* second, size_t secondSize, unsigned int* result)
+{
+	unsigned long long int current, carry, multiplier;
+
+	for (size_t i = 0; i < firstSize + secondSize; i++) result[i] = 0;
+
+	for (size_t i = 0; i < firstSize; i++)
+	{
+		multiplier = first[i];
+		if (multiplier == 0) continue;
+
+		carry = 0;
+		for (size_t j = 0; j < secondSize; j++)
 		{
-			first = parts[i];
-			second = other.parts[j];
-			product = first * second;
+			current = result[i + j] + multiplier * second[j] + carry;
+			result[i + j] = (unsigned int)current;
+			carry = current >> partBits;
+		}
+		result[i + secondSize] = (unsigned int)carry;
+	}
+}
 
-			temp.parts.resize(2);
-			temp.parts[0] = product % basePowerLimit;
-			temp.parts[1] = product / basePowerLimit;
-			temp.simplifyNumber();
-			temp.extendParts(i + j);
+void Number::squareSchoolbook(const unsigned int* source, size_t size, unsigned int* result)
+{
+	unsigned long long int current, carry, multiplier, square;
+
+	for (size_t i = 0; i < 2 * size; i++) result[i] = 0;
 
-			result = result + temp;
+	for (size_t i = 0; i + 1 < size; i++)
+	{
+		multiplier = source[i];
+		if (multiplier == 0) continue;
+
+		carry = 0;
+		for (size_t j = i + 1; j < size; j++)
+		{
+			current = result[i + j] + multiplier * source[j] + carry;
+			result[i + j] = (unsigned int)current;
+			carry = current >> partBits;
 		}
+		result[i + size] = (unsigned int)carry;
 	}
 
-	return result;
+	carry = 0;
+	for (size_t i = 0; i < size; i++)
+	{
+		square = (unsigned long long int)source[i] * source[i];
+
+		current = ((unsigned long long int)result[2 * i] << 1) + (unsigned int)square + carry;
+		result[2 * i] = (unsigned int)current;
+		carry = current >> partBits;
+
+		current = ((unsigned long long int)result[2 * i + 1] << 1) + (square >> partBits) + carry;
+		result[2 * i + 1] = (unsigned int)current;
+		carry = current >> partBits;
+	}
 }
 
-Number Number::operator/(const Number& other) const
+void Number::multiplyKaratsuba(const unsigned int* first, size_t firstSize, const unsigned int* second, size_t secondSize, unsigned int* result)
+{
+	size_t half = (firstSize + 1) / 2;
+	size_t firstHigh = firstSize - half, secondHigh = secondSize - half;
+	size_t firstSumSize, secondSumSize;
+
+	LimbBuffer firstSum(half + 1), secondSum(half + 1), middle(2 * half + 2);
+	firstSum[half] = addParts(firstSum.data(), first, half, first + half, firstHigh);
+	secondSum[half] = addParts(secondSum.data(), second, half, second + half, secondHigh);
+	firstSumSize = half + firstSum[half];
+	secondSumSize = half + secondSum[half];
+
+	ThreadPool* pool = parallelPool(secondSize);
+	if (pool)
+	{
+		ThreadPool::TaskGroup products(*pool);
+		products.run([=]() { multiplyParts(first, half, second, half, result); });
+		products.run([=]() { multiplyParts(first + half, firstHigh, second + half, secondHigh, result + 2 * half); });
+		multiplyParts(firstSum.data(), firstSumSize, secondSum.data(), secondSumSize, middle.data());
+		products.wait();
+	}
+	else
+	{
+		multiplyParts(first, half, second, half, result);
+		multiplyParts(first + half, firstHigh, second + half, secondHigh, result + 2 * half);
+		multiplyParts(firstSum.data(), firstSumSize, secondSum.data(), secondSumSize, middle.data());
+	}
+
+	subtractFromParts(middle.data(), firstSumSize + secondSumSize, result, 2 * half);
+	subtractFromParts(middle.data(), firstSumSize + secondSumSize, result + 2 * half, firstHigh + secondHigh);
+
+	addIntoParts(result + half, firstSize + secondSize - half, middle.data(), std::min(firstSumSize + secondSumSize, firstSize + secondSize - half));
+}
+
+void Number::squareKaratsuba(const unsigned int* source, size_t size, unsigned int* result)
 {
-	if (other == Number(0)) return Number(0);
-	if (*this < other) return Number(0);
+	size_t half = (size + 1) / 2;
+	size_t high = size - half, sumSize;
 
-	Number result, remainder = *this, divider = other;
-	int power = -1;
-	unsigned int counter;
+	squareParts(source, half, result);
+	squareParts(source + half, high, result + 2 * half);
 
-	while (!(divider > remainder))
+	LimbBuffer sum(half + 1), middle(2 * half + 2);
+	sum[half] = addParts(sum.data(), source, half, source + half, high);
+	sumSize = half + sum[half];
+
+	squareParts(sum.data(), sumSize, middle.data());
+	subtractFromParts(middle.data(), 2 * sumSize, result, 2 * half);
+	subtractFromParts(middle.data(), 2 * sumSize, result + 2 * half, 2 * high);
+
+	addIntoParts(result + half, 2 * size - half, middle.data(), std::min(2 * sumSize, 2 * size - half));
+}
+
+void Number::multiplyToomThree(const unsigned int* first, size_t firstSize, const unsigned int* second, size_t secondSize, unsigned int* result)
+{
+	size_t third = (firstSize + 2) / 3;
+
+	Number a0 = fromParts(first, third), a1 = fromParts(first + third, third), a2 = fromParts(first + 2 * third, firstSize - 2 * third);
+	Number b0 = fromParts(second, third), b1 = fromParts(second + third, third), b2 = fromParts(second + 2 * third, secondSize - 2 * third);
+
+	/// Evaluation at 0, 1, -1, -2 and infinity
+	Number firstOne = a0 + a2, secondOne = b0 + b2;
+	Number firstMinusOne = firstOne, secondMinusOne = secondOne;
+	bool firstMinusOneNegative = false, secondMinusOneNegative = false;
+	firstOne += a1;
+	secondOne += b1;
+	addSigned(firstMinusOne, firstMinusOneNegative, a1, true);
+	addSigned(secondMinusOne, secondMinusOneNegative, b1, true);
+
+	Number firstMinusTwo = firstMinusOne, secondMinusTwo = secondMinusOne;
+	bool firstMinusTwoNegative = firstMinusOneNegative, secondMinusTwoNegative = secondMinusOneNegative;
+	addSigned(firstMinusTwo, firstMinusTwoNegative, a2, false);
+	addSigned(secondMinusTwo, secondMinusTwoNegative, b2, false);
+	firstMinusTwo += firstMinusTwo;
+	secondMinusTwo += secondMinusTwo;
+	addSigned(firstMinusTwo, firstMinusTwoNegative, a0, true);
+	addSigned(secondMinusTwo, secondMinusTwoNegative, b0, true);
+
+	Number valueZero, valueOne, valueMinusOne, valueMinusTwo, valueInfinity;
+	ThreadPool* pool = parallelPool(secondSize);
+	if (pool)
 	{
-		power++;
-		divider.multiplyByBase();
+		ThreadPool::TaskGroup products(*pool);
+		products.run([&]() { multiply(a0, b0, valueZero); });
+		products.run([&]() { multiply(firstOne, secondOne, valueOne); });
+		products.run([&]() { multiply(firstMinusOne, secondMinusOne, valueMinusOne); });
+		products.run([&]() { multiply(firstMinusTwo, secondMinusTwo, valueMinusTwo); });
+		multiply(a2, b2, valueInfinity);
+		products.wait();
 	}
-	divider.divideByBase();
+	else
+	{
+		multiply(a0, b0, valueZero);
+		multiply(firstOne, secondOne, valueOne);
+		multiply(firstMinusOne, secondMinusOne, valueMinusOne);
+		multiply(firstMinusTwo, secondMinusTwo, valueMinusTwo);
+		multiply(a2, b2, valueInfinity);
+	}
+	bool valueMinusOneNegative = (firstMinusOneNegative != secondMinusOneNegative);
+	bool valueMinusTwoNegative = (firstMinusTwoNegative != secondMinusTwoNegative);
+
+	/// Interpolation (Bodrato's sequence)
+	Number coefficientThree = valueMinusTwo, coefficientOne = valueOne, coefficientTwo = valueMinusOne;
+	bool coefficientThreeNegative = valueMinusTwoNegative, coefficientOneNegative = false, coefficientTwoNegative = valueMinusOneNegative;
+
+	addSigned(coefficientThree, coefficientThreeNegative, valueOne, true);
+	divideBySmall(coefficientThree, 3);
+	addSigned(coefficientOne, coefficientOneNegative, valueMinusOne, !valueMinusOneNegative);
+	divideBySmall(coefficientOne, 2);
+	addSigned(coefficientTwo, coefficientTwoNegative, valueZero, true);
+
+	Number temp = coefficientTwo;
+	bool tempNegative = coefficientTwoNegative;
+	addSigned(temp, tempNegative, coefficientThree, !coefficientThreeNegative);
+	divideBySmall(temp, 2);
+	addSigned(temp, tempNegative, valueInfinity + valueInfinity, false);
+	coefficientThree = temp;
+	coefficientThreeNegative = tempNegative;
+
+	addSigned(coefficientTwo, coefficientTwoNegative, coefficientOne, coefficientOneNegative);
+	addSigned(coefficientTwo, coefficientTwoNegative, valueInfinity, true);
+	addSigned(coefficientOne, coefficientOneNegative, coefficientThree, !coefficientThreeNegative);
+
+	const Number* coefficients[5] = { &valueZero, &coefficientOne, &coefficientTwo, &coefficientThree, &valueInfinity };
+	for (size_t i = 0; i < firstSize + secondSize; i++) result[i] = 0;
+	for (size_t i = 0; i < 5; i++)
+	{
+		addIntoParts(result + i * third, firstSize + secondSize - i * third, coefficients[i]->parts, coefficients[i]->numberOfParts());
+	}
+}
 
-	do
+void Number::multiplyParts(const unsigned int* first, size_t firstSize, const unsigned int* second, size_t secondSize, unsigned int* result)
+{
+	if (firstSize < secondSize)
+	{
+		std::swap(first, second);
+		std::swap(firstSize, secondSize);
+	}
+
+	if (secondSize == 0)
+	{
+		for (size_t i = 0; i < firstSize; i++) result[i] = 0;
+	}
+	else if (secondSize < karatsubaThreshold) multiplySchoolbook(first, firstSize, second, secondSize, result);
+	else if (firstSize >= 2 * secondSize)
 	{
-		power--;
-		result.multiplyByBase();
-		counter = 0;
-		while (!(remainder < divider))
+		LimbBuffer temp(2 * secondSize);
+		size_t currentSize;
+
+		for (size_t i = 0; i < firstSize + secondSize; i++) result[i] = 0;
+		for (size_t offset = 0; offset < firstSize; offset += secondSize)
 		{
-			remainder = remainder - divider;
-			counter++;
+			currentSize = std::min(secondSize, firstSize - offset);
+			multiplyParts(first + offset, currentSize, second, secondSize, temp.data());
+			addIntoParts(result + offset, firstSize + secondSize - offset, temp.data(), currentSize + secondSize);
 		}
-		result.parts[0] += counter;
-		divider.divideByBase();
+	}
+	else if (secondSize < toomThreeThreshold || secondSize <= 2 * ((firstSize + 2) / 3)) multiplyKaratsuba(first, firstSize, second, secondSize, result);
+	else multiplyToomThree(first, firstSize, second, secondSize, result);
+}
+
+void Number::squareParts(const unsigned int* source, size_t size, unsigned int* result)
+{
+	if (size < squareKaratsubaThreshold) squareSchoolbook(source, size, result);
+	else if (size < squareToomThreeThreshold) squareKaratsuba(source, size, result);
+	else multiplyToomThree(source, size, source, size, result);
+}
 
-	} while (power >= 0);
+ThreadPool* Number::parallelPool(size_t size)
+{
+	if (size < parallelMultiplicationThreshold || multiplicationThreads <= 1) return nullptr;
+
+	std::lock_guard<std::mutex> lock(multiplicationPoolMutex);
+	if (!multiplicationPool) multiplicationPool.reset(new ThreadPool(multiplicationThreads));
+	return multiplicationPool.get();
+}
+
+Number::Number(unsigned int x)
+{
+	parts = localParts;
+	partsCapacity = localCapacity;
+	partsSize = 1;
+	parts[0] = x;
+}
+
+Number::Number(const std::string& s)
+{
+	parts = localParts;
+	partsCapacity = localCapacity;
+	partsSize = 1;
+	parts[0] = 0;
+
+	std::vector<Number> powers;
+	Number result = parseDecimal(s.data(), s.size(), powers);
+	swapParts(result);
+}
 
+Number::Number(const Number& other)
+{
+	parts = localParts;
+	partsCapacity = localCapacity;
+	partsSize = 0;
+	copyData(other);
+}
+
+Number::Number(Number&& other) noexcept
+{
+	parts = localParts;
+	partsCapacity = localCapacity;
+	partsSize = 0;
+
+	if (other.parts != other.localParts)
+	{
+		parts = other.parts;
+		partsSize = other.partsSize;
+		partsCapacity = other.partsCapacity;
+
+		other.parts = other.localParts;
+		other.partsCapacity = localCapacity;
+		other.partsSize = 1;
+		other.parts[0] = 0;
+	}
+	else copyData(other);
+}
+
+Number& Number::operator=(const Number& other)
+{
+	if (this != &other) copyData(other);
+	return *this;
+}
+
+Number& Number::operator=(Number&& other) noexcept
+{
+	if (this != &other)
+	{
+		if (other.parts != other.localParts) swapParts(other);
+		else copyData(other);
+	}
+	return *this;
+}
+
+Number::~Number()
+{
+	if (parts != localParts) LimbAllocator::release(parts, partsCapacity);
+}
+
+Number Number::operator+(const Number& other) const
+{
+	Number result;
+	add(*this, other, result);
+	return result;
+}
+
+Number Number::operator-(const Number& other) const
+{
+	Number result;
+	subtract(*this, other, result);
 	return result;
 }
 
+Number Number::operator*(const Number& other) const
+{
+	Number result;
+	multiply(*this, other, result);
+	return result;
+}
+
+Number Number::operator/(const Number& other) const
+{
+	Number quotient, remainder;
+	divmod(other, quotient, remainder);
+	return quotient;
+}
+
 Number Number::operator%(const Number& other) const
 {
-	if (other == Number(0)) return Number(0);
-	if (*this < other) return *this;
+	Number quotient, remainder;
+	divmod(other, quotient, remainder);
+	return remainder;
+}
 
-	Number remainder = *this, divider = other;
-	int power = -1;
+void Number::divmod(const Number& other, Number& quotient, Number& remainder) const
+{
+	if (other.isZero())
+	{
+		quotient = Number(0);
+		remainder = Number(0);
+	}
+	else if (*this < other)
+	{
+		remainder = *this;
+		quotient = Number(0);
+	}
+	else if (other.numberOfParts() == 1)
+	{
+		unsigned int divider = other.parts[0];
+		quotient = *this;
+		remainder = Number(divideBySmall(quotient, divider));
+	}
+	else if (other.numberOfParts() >= burnikelZieglerThreshold && numberOfParts() - other.numberOfParts() >= burnikelZieglerThreshold)
+	{
+		divideBurnikelZiegler(*this, other, quotient, remainder);
+	}
+	else divideKnuth(*this, other, quotient, remainder);
+}
 
-	while (!(divider > remainder))
+Number& Number::operator+=(const Number& other)
+{
+	size_t otherSize = other.numberOfParts();
+	unsigned int carry;
+
+	if (numberOfParts() < otherSize) resizeParts(otherSize);
+	reserveParts(numberOfParts() + 1);
+
+	carry = addParts(parts, parts, numberOfParts(), other.parts, otherSize);
+	if (carry > 0) parts[partsSize++] = carry;
+
+	return *this;
+}
+
+Number& Number::operator-=(const Number& other)
+{
+	if (*this < other)
 	{
-		power++;
-		divider.multiplyByBase();
+		partsSize = 1;
+		parts[0] = 0;
+		return *this;
 	}
-	divider.divideByBase();
 
-	do
+	subtractFromParts(parts, numberOfParts(), other.parts, other.numberOfParts());
+	simplifyNumber();
+	return *this;
+}
+
+Number& Number::operator*=(const Number& other)
+{
+	Number result;
+	multiply(*this, other, result);
+	swapParts(result);
+	return *this;
+}
+
+Number& Number::operator/=(const Number& other)
+{
+	Number quotient, remainder;
+	divmod(other, quotient, remainder);
+	swapParts(quotient);
+	return *this;
+}
+
+Number& Number::operator%=(const Number& other)
+{
+	Number quotient, remainder;
+	divmod(other, quotient, remainder);
+	swapParts(remainder);
+	return *this;
+}
+
+void Number::add(const Number& first, const Number& second, Number& result)
+{
+	if (&result == &first)
+	{
+		result += second;
+		return;
+	}
+	if (&result == &second)
 	{
-		power--;
-		while (!(remainder < divider)) remainder = remainder - divider;
-		divider.divideByBase();
+		result += first;
+		return;
+	}
 
-	} while (power >= 0);
+	const Number& longer = (first.numberOfParts() >= second.numberOfParts()) ? first : second;
+	const Number& shorter = (first.numberOfParts() >= second.numberOfParts()) ? second : first;
+	unsigned int carry;
 
-	return remainder;
+	result.partsSize = 0;
+	result.reserveParts(longer.numberOfParts() + 1);
+
+	carry = addParts(result.parts, longer.parts, longer.numberOfParts(), shorter.parts, shorter.numberOfParts());
+	result.partsSize = longer.numberOfParts();
+	if (carry > 0) result.parts[result.partsSize++] = carry;
+}
+
+void Number::subtract(const Number& first, const Number& second, Number& result)
+{
+	if (first < second)
+	{
+		result.partsSize = 1;
+		result.parts[0] = 0;
+		return;
+	}
+	if (&result == &first)
+	{
+		result -= second;
+		return;
+	}
+	if (&result == &second)
+	{
+		Number difference;
+		subtract(first, second, difference);
+		result.swapParts(difference);
+		return;
+	}
+
+	result.partsSize = 0;
+	result.reserveParts(first.numberOfParts());
+
+	subtractParts(result.parts, first.parts, first.numberOfParts(), second.parts, second.numberOfParts());
+	result.partsSize = first.numberOfParts();
+	result.simplifyNumber();
+}
+
+void Number::multiply(const Number& first, const Number& second, Number& result)
+{
+	if (first.isZero() || second.isZero())
+	{
+		result.partsSize = 1;
+		result.parts[0] = 0;
+		return;
+	}
+	if (&result == &first || &result == &second)
+	{
+		Number product;
+		multiply(first, second, product);
+		result.swapParts(product);
+		return;
+	}
+
+	result.partsSize = 0;
+	result.reserveParts(first.numberOfParts() + second.numberOfParts());
+	result.partsSize = first.numberOfParts() + second.numberOfParts();
+
+	if (&first == &second || first.equalParts(second)) squareParts(first.parts, first.numberOfParts(), result.parts);
+	else multiplyParts(first.parts, first.numberOfParts(), second.parts, second.numberOfParts(), result.parts);
+
+	result.simplifyNumber();
+}
+
+void Number::setParallelMultiplication(size_t threshold, unsigned int threads)
+{
+	std::lock_guard<std::mutex> lock(multiplicationPoolMutex);
+	parallelMultiplicationThreshold = threshold;
+	multiplicationThreads = std::max(1u, threads);
+	multiplicationPool.reset();
 }
 
 bool Number::operator<(const Number& other) const
@@ -255,12 +1026,7 @@ bool Number::operator<(const Number& other) const
 	if (numberOfParts() < other.numberOfParts()) return true;
 	if (numberOfParts() > other.numberOfParts()) return false;
 
-	for (int i = other.numberOfParts() - 1; i >= 0; i--)
-	{
-		if (parts[i] < other.parts[i]) return true;
-		if (parts[i] > other.parts[i]) return false;
-	}
-	return false;
+	return LimbKernels::compare(parts, other.parts, numberOfParts()) < 0;
 }
 
 bool Number::operator>(const Number& other) const
@@ -280,12 +1046,7 @@ bool Number::operator>=(const Number& other) const
 
 bool Number::operator==(const Number& other) const
 {
-	if (numberOfParts() != other.numberOfParts()) return false;
-	for (size_t i = 0; i < numberOfParts(); i++)
-	{
-		if (parts[i] != other.parts[i]) return false;
-	}
-	return true;
+	return equalParts(other);
 }
 
 bool Number::operator!=(const Number& other) const
@@ -293,24 +1054,33 @@ bool Number::operator!=(const Number& other) const
 	return !(*this == other);
 }
 
+bool Number::isZero() const
+{
+	return partsSize == 1 && parts[0] == 0;
+}
+
+bool Number::isOne() const
+{
+	return partsSize == 1 && parts[0] == 1;
+}
+
 Number::operator bool() const
 {
-	return *this > Number(0);
+	return !isZero();
 }
 
-std::ostream& operator<<(std::ostream& os, const Number& num)
+std::string Number::toString() const
 {
-	os << num.parts.back();
-	for (int i = num.numberOfParts() - 2; i >= 0; i--)
-	{
-		unsigned int threshold = Number::basePowerLimit / Number::base;
-		while (threshold > num.parts[i])
-		{
-			os << 0;
-			threshold /= Number::base;
-		}
-		if (num.parts[i] > 0) os << num.parts[i];
-	}
+	std::string result;
+	std::vector<Number> powers;
 
-	return os;
+	result.reserve(numberOfParts() * 10 + 1);
+	formatDecimal(*this, result, 0, powers);
+	return result;
+}
+
+std::ostream& operator<<(std::ostream& os, const Number& num)
+{
+	std::string digits = num.toString();
+	return os.write(digits.data(), digits.size());
 }
\ No newline at end of file
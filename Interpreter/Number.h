@@ -1,36 +1,110 @@
 #pragma once
 
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
+class ThreadPool;
+
 class Number
 {
 private:
-	const static unsigned int base = 10;
-	const static unsigned int basePowerLimit = 1000000000;
+	const static unsigned int partBits = 32;
+	const static unsigned int decimalBase = 1000000000;
+	const static unsigned int decimalDigits = 9;
+
+	const static size_t karatsubaThreshold = 32;
+	const static size_t toomThreeThreshold = 2000;
+	const static size_t squareKaratsubaThreshold = 48;
+	const static size_t squareToomThreeThreshold = 3000;
+	const static size_t burnikelZieglerThreshold = 32;
+	const static size_t decimalConversionThreshold = 40;
+
+	const static size_t localCapacity = 4;
+
+	static size_t parallelMultiplicationThreshold;
+	static unsigned int multiplicationThreads;
+	/// Made on the first parallel multiplication, its workers are joined at exit
+	static std::unique_ptr<ThreadPool> multiplicationPool;
 
-	std::vector<unsigned int> parts;
+	unsigned int* parts;
+	size_t partsSize;
+	size_t partsCapacity;
+	unsigned int localParts[localCapacity];
 
 	void copyData(const Number&);
 	void simplifyNumber();
-	void multiplyByBase();
-	void divideByBase();
+	void reserveParts(size_t);
+	void resizeParts(size_t);
+	void assignParts(const unsigned int*, size_t);
+	void appendPart(unsigned int);
+	void swapParts(Number&);
+	bool equalParts(const Number&) const;
+	void multiplyAddSmall(unsigned int, unsigned int);
 	void extendParts(size_t);
+	void shiftLeftBits(size_t);
+	void shiftRightBits(size_t);
 
-	size_t numberOfParts() const;
+	static Number partsRange(const Number&, size_t, size_t);
+	static void addSigned(Number&, bool&, const Number&, bool);
+	static unsigned int divideBySmall(Number&, unsigned int);
+	static void divideKnuth(const Number&, const Number&, Number&, Number&);
+	static void divideThreeHalves(const Number&, const Number&, Number&, Number&);
+	static void divideRecursive(const Number&, const Number&, Number&, Number&);
+	static void divideBurnikelZiegler(const Number&, const Number&, Number&, Number&);
+
+	static Number parseDecimal(const char*, size_t, std::vector<Number>&);
+	static void formatSmall(const Number&, std::string&, size_t);
+	static void formatDecimal(const Number&, std::string&, size_t, std::vector<Number>&);
+
+	static unsigned int addParts(unsigned int*, const unsigned int*, size_t, const unsigned int*, size_t);
+	static unsigned int subtractParts(unsigned int*, const unsigned int*, size_t, const unsigned int*, size_t);
+	static void addIntoParts(unsigned int*, size_t, const unsigned int*, size_t);
+	static void subtractFromParts(unsigned int*, size_t, const unsigned int*, size_t);
+
+	static void multiplySchoolbook(const unsigned int*, size_t, const unsigned int*, size_t, unsigned int*);
+	static void squareSchoolbook(const unsigned int*, size_t, unsigned int*);
+	static void multiplyKaratsuba(const unsigned int*, size_t, const unsigned int*, size_t, unsigned int*);
+	static void squareKaratsuba(const unsigned int*, size_t, unsigned int*);
+	static void multiplyToomThree(const unsigned int*, size_t, const unsigned int*, size_t, unsigned int*);
+	static void multiplyParts(const unsigned int*, size_t, const unsigned int*, size_t, unsigned int*);
+	static void squareParts(const unsigned int*, size_t, unsigned int*);
+	static ThreadPool* parallelPool(size_t);
 
 public:
 	Number(unsigned int x = 0);
 	Number(const std::string&);
 	Number(const Number&);
+	Number(Number&&) noexcept;
 	Number& operator=(const Number&);
+	Number& operator=(Number&&) noexcept;
+	~Number();
 
 	Number operator+(const Number&) const;
 	Number operator-(const Number&) const;
 	Number operator*(const Number&) const;
 	Number operator/(const Number&) const;
 	Number operator%(const Number&) const;
+	void divmod(const Number&, Number&, Number&) const;
+
+	Number& operator+=(const Number&);
+	Number& operator-=(const Number&);
+	Number& operator*=(const Number&);
+	Number& operator/=(const Number&);
+	Number& operator%=(const Number&);
+
+	/// The number with the given 32-bit limbs, least significant first
+	static Number fromParts(const unsigned int*, size_t);
+
+	static void add(const Number&, const Number&, Number&);
+	static void subtract(const Number&, const Number&, Number&);
+	static void multiply(const Number&, const Number&, Number&);
+
+	/// Multiplications whose shorter operand has at least threshold limbs split their
+	/// sub-products across the given number of threads (1 disables it). The threads
+	/// of the previous setting are joined, so no multiplication may be running.
+	static void setParallelMultiplication(size_t, unsigned int);
 
 	bool operator<(const Number&) const;
 	bool operator>(const Number&) const;
@@ -39,9 +113,19 @@ public:
 	bool operator==(const Number&) const;
 	bool operator!=(const Number&) const;
 
+	bool isZero() const;
+	bool isOne() const;
+
+	/// Number of 32-bit limbs in use
+	size_t numberOfParts() const;
+
 	operator bool() const;
 
+	std::string toString() const;
+
 	friend std::ostream& operator<<(std::ostream&, const Number&);
+	/// The machine code it makes works on numbers of one part in place
+	friend class JitCompiler;
 };
 
 std::ostream& operator<<(std::ostream&, const Number&);
@@ -0,0 +1,169 @@
+#include "Optimizer.h"
+
+#include <utility>
+
+void Optimizer::replaceWithChild(Instruction& Ins, size_t index)
+{
+	Instruction child = std::move(Ins.parameters[index]);
+	Ins = std::move(child);
+}
+
+void Optimizer::makeBoolean(Instruction& Ins, bool value)
+{
+	Instruction constant(Instruction::basicBooleanType);
+	constant.booleanValue = value;
+	Ins = std::move(constant);
+}
+
+void Optimizer::foldValue(Instruction& Ins)
+{
+	switch (Ins.type)
+	{
+	case Instruction::arithmeticType:
+	{
+		foldValue(Ins.parameters[0]);
+		foldValue(Ins.parameters[1]);
+
+		const Instruction& first = Ins.parameters[0];
+		const Instruction& second = Ins.parameters[1];
+		if (first.type != Instruction::numberType || second.type != Instruction::numberType) return;
+		if ((Ins.operation == '/' || Ins.operation == '%') && second.number.isZero()) return;
+
+		Instruction constant(Instruction::numberType);
+		switch (Ins.operation)
+		{
+		case '+':
+			Number::add(first.number, second.number, constant.number);
+			break;
+		case '-':
+			Number::subtract(first.number, second.number, constant.number);
+			break;
+		case '*':
+			Number::multiply(first.number, second.number, constant.number);
+			break;
+		case '/':
+			constant.number = first.number / second.number;
+			break;
+		case '%':
+			constant.number = first.number % second.number;
+			break;
+		}
+		Ins = std::move(constant);
+		break;
+	}
+	case Instruction::booleanType:
+	{
+		foldValue(Ins.parameters[0]);
+		if (Ins.operation != '!') foldValue(Ins.parameters[1]);
+
+		const Instruction& first = Ins.parameters[0];
+		bool firstConstant = (first.type == Instruction::basicBooleanType);
+
+		switch (Ins.operation)
+		{
+		case '!':
+			if (firstConstant) makeBoolean(Ins, !first.booleanValue);
+			break;
+		case '&':
+		case '|':
+		{
+			/// A constant first condition decides the result or leaves only the second one.
+			/// A constant second condition may only drop itself, the first one still runs.
+			bool isAnd = (Ins.operation == '&');
+			const Instruction& second = Ins.parameters[1];
+
+			if (firstConstant && first.booleanValue != isAnd) makeBoolean(Ins, !isAnd);
+			else if (firstConstant) replaceWithChild(Ins, 1);
+			else if (second.type == Instruction::basicBooleanType && second.booleanValue == isAnd) replaceWithChild(Ins, 0);
+			break;
+		}
+		default:
+		{
+			const Instruction& second = Ins.parameters[1];
+			if (first.type != Instruction::numberType || second.type != Instruction::numberType) break;
+
+			if (Ins.operation == '<') makeBoolean(Ins, first.number < second.number);
+			else if (Ins.operation == '>') makeBoolean(Ins, first.number > second.number);
+			else makeBoolean(Ins, first.number == second.number);
+			break;
+		}
+		}
+		break;
+	}
+	case Instruction::functionCallType:
+	case Instruction::tailCallType:
+		foldValue(Ins.parameters[1]);
+		break;
+	case Instruction::inlineCallType:
+		foldValue(Ins.parameters[0]);
+		foldValue(Ins.parameters[1]);
+		break;
+	default:
+		break;
+	}
+}
+
+void Optimizer::optimizeSequence(Instruction& sequence)
+{
+	std::vector<Instruction> statements;
+	statements.reserve(sequence.parameters.size());
+
+	for (size_t i = 0; i < sequence.parameters.size(); i++) optimizeStatement(sequence.parameters[i], statements);
+	sequence.parameters.swap(statements);
+}
+
+void Optimizer::optimizeStatement(Instruction& Ins, std::vector<Instruction>& statements)
+{
+	switch (Ins.type)
+	{
+	case Instruction::defaultType:
+		return;
+	case Instruction::sequenceType:
+		optimizeSequence(Ins);
+		break;
+	case Instruction::ifStatementType:
+	{
+		foldValue(Ins.parameters[0]);
+		optimizeSequence(Ins.parameters[1]);
+		optimizeSequence(Ins.parameters[2]);
+
+		if (Ins.parameters[0].type == Instruction::basicBooleanType)
+		{
+			/// Only the taken branch is kept, its statements run in the same frame anyway
+			std::vector<Instruction>& branch = Ins.parameters[Ins.parameters[0].booleanValue ? 1 : 2].parameters;
+			for (size_t i = 0; i < branch.size(); i++) statements.push_back(std::move(branch[i]));
+			return;
+		}
+		break;
+	}
+	case Instruction::whileStatementType:
+	{
+		foldValue(Ins.parameters[0]);
+		if (Ins.parameters[0].type == Instruction::basicBooleanType && !Ins.parameters[0].booleanValue) return;
+		optimizeSequence(Ins.parameters[1]);
+		break;
+	}
+	case Instruction::printType:
+	case Instruction::returnType:
+		foldValue(Ins.parameters[0]);
+		break;
+	case Instruction::variableDefinitionType:
+		foldValue(Ins.parameters[1]);
+		break;
+	case Instruction::functionDefinitionType:
+		foldValue(Ins.parameters[2]);
+		break;
+	case Instruction::recursiveFunctionDefinitionType:
+		optimizeSequence(Ins.parameters[2]);
+		break;
+	default:
+		break;
+	}
+
+	statements.push_back(std::move(Ins));
+}
+
+void Optimizer::optimize(Instruction& mainSequence)
+{
+	optimizeSequence(mainSequence);
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Instruction.h"
+
+/// Rewrites a parsed program before it runs: folds constant subexpressions and
+/// conditions and removes code that can never run. Everything that may fail at
+/// run time (a division by zero, an undefined name) is left in place, so errors
+/// are still reported when their statement executes.
+class Optimizer
+{
+private:
+	static void replaceWithChild(Instruction&, size_t);
+	static void makeBoolean(Instruction&, bool);
+
+	static void foldValue(Instruction&);
+	static void optimizeSequence(Instruction&);
+	static void optimizeStatement(Instruction&, std::vector<Instruction>&);
+
+public:
+	static void optimize(Instruction& mainSequence);
+};
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include "ThreadPool.h"
+
+void ThreadPool::workerLoop()
+{
+	std::unique_lock<std::mutex> lock(stateMutex);
+
+	while (true)
+	{
+		stateChanged.wait(lock, [this]() { return stopping || !tasks.empty(); });
+		if (tasks.empty()) return;
+
+		std::function<void()> task = std::move(tasks.front());
+		tasks.pop_front();
+
+		lock.unlock();
+		task();
+		lock.lock();
+	}
+}
+
+ThreadPool::ThreadPool(unsigned int threads)
+{
+	stopping = false;
+	for (unsigned int i = 1; i < threads; i++) workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(stateMutex);
+		stopping = true;
+	}
+	stateChanged.notify_all();
+
+	for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+}
+
+unsigned int ThreadPool::numberOfThreads() const
+{
+	return workers.size() + 1;
+}
+
+ThreadPool::TaskGroup::TaskGroup(ThreadPool& pool) : pool(pool)
+{
+	pendingTasks = 0;
+}
+
+ThreadPool::TaskGroup::~TaskGroup()
+{
+	finishTasks();
+}
+
+void ThreadPool::TaskGroup::run(std::function<void()> task)
+{
+	if (pool.workers.empty())
+	{
+		task();
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(pool.stateMutex);
+		pendingTasks++;
+		pool.tasks.push_back([this, task]()
+		{
+			/// Queued tasks never throw, whichever thread runs them
+			std::exception_ptr thrown;
+			try
+			{
+				task();
+			}
+			catch (...)
+			{
+				thrown = std::current_exception();
+			}
+
+			std::lock_guard<std::mutex> lock(pool.stateMutex);
+			if (thrown && !failure) failure = thrown;
+			pendingTasks--;
+			pool.stateChanged.notify_all();
+		});
+	}
+	pool.stateChanged.notify_one();
+}
+
+void ThreadPool::TaskGroup::wait()
+{
+	finishTasks();
+
+	std::exception_ptr thrown;
+	{
+		std::lock_guard<std::mutex> lock(pool.stateMutex);
+		thrown = failure;
+		failure = nullptr;
+	}
+	if (thrown) std::rethrow_exception(thrown);
+}
+
+void ThreadPool::TaskGroup::finishTasks()
+{
+	std::unique_lock<std::mutex> lock(pool.stateMutex);
+
+	while (pendingTasks > 0)
+	{
+		if (pool.tasks.empty())
+		{
+			pool.stateChanged.wait(lock);
+			continue;
+		}
+
+		std::function<void()> task = std::move(pool.tasks.front());
+		pool.tasks.pop_front();
+
+		lock.unlock();
+		task();
+		lock.lock();
+	}
+}
\ No newline at end of file
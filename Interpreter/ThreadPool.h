@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> tasks;
+	std::mutex stateMutex;
+	std::condition_variable stateChanged;
+	bool stopping;
+
+	void workerLoop();
+
+public:
+	/// A set of tasks waited for together. The waiting thread keeps running queued
+	/// tasks (of any group) until its own ones are finished.
+	class TaskGroup
+	{
+	private:
+		ThreadPool& pool;
+		size_t pendingTasks;
+		/// The first exception thrown by a task of the group
+		std::exception_ptr failure;
+
+		void finishTasks();
+
+	public:
+		TaskGroup(ThreadPool&);
+		/// Waits for the tasks, but drops their exception
+		~TaskGroup();
+
+		void run(std::function<void()>);
+		/// Rethrows the first exception of a task once all of them are finished
+		void wait();
+	};
+
+	ThreadPool(unsigned int);
+	~ThreadPool();
+
+	unsigned int numberOfThreads() const;
+};
\ No newline at end of file
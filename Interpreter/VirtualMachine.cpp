@@ -0,0 +1,342 @@
+#include "VirtualMachine.h"
+#include "Instruction.h"
+#include "Interpreter Error Flags.h"
+
+#include <utility>
+
+Number& VirtualMachine::push()
+{
+	/// Popped entries stay constructed, so their limb storage is reused by the next push
+	if (stackSize == stack.size())
+	{
+		stack.emplace_back();
+		stackEntries = stack.data();
+	}
+	return stack[stackSize++];
+}
+
+void VirtualMachine::tierUp(int function, size_t& pc)
+{
+	if (jitThreshold == 0) return;
+
+	JitCode& native = compiled[function];
+	if (!native.isCompiled())
+	{
+		if (++hotness[function] < jitThreshold) return;
+		if (!JitCompiler::compile(*this, context.program->functions[function], native))
+		{
+			/// Nothing else will compile either, keep interpreting
+			jitThreshold = 0;
+			return;
+		}
+	}
+
+	pc = native.run(*this, pc);
+}
+
+void VirtualMachine::resumeCompiled(int function, size_t& pc)
+{
+	if (jitThreshold != 0 && compiled[function].isCompiled()) pc = compiled[function].run(*this, pc);
+}
+
+VirtualMachine::VirtualMachine(unsigned int jitThreshold)
+{
+	stackSize = 0;
+	stackEntries = nullptr;
+	this->jitThreshold = (JitCompiler::isSupported() ? jitThreshold : 0);
+}
+
+void VirtualMachine::run(const BytecodeProgram& program, Environment& environment, char& state, std::string& undefinedObject, std::ostream& os, std::istream& is)
+{
+	int function = 0;
+	const BytecodeInstruction* code = program.functions[0].code.data();
+	size_t pc = 0;
+
+	stackSize = 0;
+	frames.clear();
+	environment.pushFrame();
+
+	context.program = &program;
+	context.environment = &environment;
+	context.state = &state;
+	context.undefinedObject = &undefinedObject;
+	context.os = &os;
+	hotness.assign(program.functions.size(), 0);
+	compiled.clear();
+	compiled.resize(program.functions.size());
+
+	while (state == InterpreterErrorFlags::normalStateFlag)
+	{
+		const BytecodeInstruction& instruction = code[pc++];
+
+		switch (instruction.opcode)
+		{
+		case pushConstantOpcode:
+			push() = program.constants[instruction.operand];
+			break;
+		case loadVariableOpcode:
+		{
+			const Binding& binding = environment.lookup(instruction.operand);
+			if (binding.kind != Binding::numberBinding)
+			{
+				state = InterpreterErrorFlags::undefinedVariableFlag;
+				undefinedObject = program.names[instruction.operand];
+				break;
+			}
+			push() = binding.number;
+			break;
+		}
+		case storeVariableOpcode:
+			environment.defineNumber(instruction.operand, std::move(stack[--stackSize]));
+			break;
+		case readVariableOpcode:
+		{
+			os << "> ";
+			std::string input;
+			Number num;
+			is >> input;
+			if (!Instruction::convertNumber(input, num))
+			{
+				state = InterpreterErrorFlags::invalidInputFlag;
+				break;
+			}
+			environment.defineNumber(instruction.operand, std::move(num));
+			resumeCompiled(function, pc);
+			break;
+		}
+		case printOpcode:
+			os << stack[--stackSize] << '\n';
+			break;
+		case addOpcode:
+		case subtractOpcode:
+		case multiplyOpcode:
+		case divideOpcode:
+		case moduloOpcode:
+		{
+			Number& first = stack[stackSize - 2];
+			const Number& second = stack[stackSize - 1];
+
+			if ((instruction.opcode == divideOpcode || instruction.opcode == moduloOpcode) && second.isZero())
+			{
+				state = InterpreterErrorFlags::divisionByZeroFlag;
+				break;
+			}
+
+			switch (instruction.opcode)
+			{
+			case addOpcode:
+				first += second;
+				break;
+			case subtractOpcode:
+				first -= second;
+				break;
+			case multiplyOpcode:
+				Number::multiply(first, second, first);
+				break;
+			case divideOpcode:
+				first /= second;
+				break;
+			default:
+				first %= second;
+				break;
+			}
+			stackSize--;
+			break;
+		}
+		case divideModuloOpcode:
+		{
+			Number& first = stack[stackSize - 2];
+			Number& second = stack[stackSize - 1];
+			if (second.isZero())
+			{
+				state = InterpreterErrorFlags::divisionByZeroFlag;
+				break;
+			}
+
+			Number quotient, remainder;
+			first.divmod(second, quotient, remainder);
+			first = std::move(quotient);
+			second = std::move(remainder);
+			break;
+		}
+		case lessOpcode:
+		case greaterOpcode:
+		case equalOpcode:
+		{
+			const Number& first = stack[stackSize - 2];
+			const Number& second = stack[stackSize - 1];
+			bool result;
+
+			if (instruction.opcode == lessOpcode) result = first < second;
+			else if (instruction.opcode == greaterOpcode) result = first > second;
+			else result = first == second;
+
+			stackSize -= 2;
+			push() = program.constants[result ? 1 : 0];
+			break;
+		}
+		case notOpcode:
+		{
+			bool result = !stack[--stackSize];
+			push() = program.constants[result ? 1 : 0];
+			break;
+		}
+		case jumpOpcode:
+		{
+			/// A jump back closes an iteration of a loop
+			bool backward = ((size_t)instruction.operand < pc);
+			pc = instruction.operand;
+			if (backward) tierUp(function, pc);
+			break;
+		}
+		case jumpIfFalseOpcode:
+			if (!stack[--stackSize]) pc = instruction.operand;
+			break;
+		case jumpIfTrueOpcode:
+			if (stack[--stackSize]) pc = instruction.operand;
+			break;
+		case defineFunctionOpcode:
+			environment.defineFunction(program.functions[instruction.operand].name, instruction.operand);
+			resumeCompiled(function, pc);
+			break;
+		case checkFunctionOpcode:
+			if (environment.lookup(instruction.operand).kind != Binding::functionBinding)
+			{
+				state = InterpreterErrorFlags::undefinedFunctionFlag;
+				undefinedObject = program.names[instruction.operand];
+			}
+			break;
+		case callOpcode:
+		{
+			int called = environment.lookup(instruction.operand).function;
+			int memoTable = program.functions[called].memoTable;
+
+			if (memoTable >= 0)
+			{
+				const Number* cached = environment.memoCaches[memoTable].find(stack[stackSize - 1]);
+				if (cached)
+				{
+					stack[stackSize - 1] = *cached;
+					resumeCompiled(function, pc);
+					break;
+				}
+			}
+
+			if (frames.size() >= environment.callLimit)
+			{
+				state = InterpreterErrorFlags::recursionLimitFlag;
+				break;
+			}
+
+			frames.emplace_back();
+			CallFrame& frame = frames.back();
+			frame.function = function;
+			frame.returnAddress = pc;
+			frame.name = instruction.operand;
+			frame.memoTable = memoTable;
+			if (memoTable >= 0) frame.argument = stack[stackSize - 1];
+
+			function = called;
+			code = program.functions[function].code.data();
+			pc = 0;
+
+			environment.pushFrame();
+			environment.defineNumber(program.functions[function].parameter, std::move(stack[--stackSize]));
+			tierUp(function, pc);
+			break;
+		}
+		case tailCallOpcode:
+		{
+			/// The caller would return right after the call, so its frame is reused
+			frames.back().name = instruction.operand;
+
+			function = environment.lookup(instruction.operand).function;
+			code = program.functions[function].code.data();
+			pc = 0;
+
+			environment.defineNumber(program.functions[function].parameter, std::move(stack[--stackSize]));
+			tierUp(function, pc);
+			break;
+		}
+		case returnOpcode:
+		{
+			/// The result stays on top of the stack for the caller
+			if (frames.back().memoTable >= 0) environment.memoCaches[frames.back().memoTable].insert(frames.back().argument, stack[stackSize - 1]);
+			environment.popFrame();
+			function = frames.back().function;
+			code = program.functions[function].code.data();
+			pc = frames.back().returnAddress;
+			frames.pop_back();
+			resumeCompiled(function, pc);
+			break;
+		}
+		case endOpcode:
+		{
+			if (frames.empty())
+			{
+				environment.popFrame();
+				return;
+			}
+			state = InterpreterErrorFlags::lackOfReturnValue;
+			undefinedObject = program.names[frames.back().name];
+			break;
+		}
+		case enterLoopOpcode:
+			environment.loopEpochs[instruction.operand]++;
+			break;
+		case loadInvariantOpcode:
+		{
+			const Environment::InvariantCache& cache = environment.invariantCaches[instruction.operand];
+			if (cache.epoch == environment.loopEpochs[cache.loop]) push() = cache.value;
+			else pc++;
+			break;
+		}
+		case storeInvariantOpcode:
+		{
+			Environment::InvariantCache& cache = environment.invariantCaches[instruction.operand];
+			cache.value = stack[stackSize - 1];
+			cache.epoch = environment.loopEpochs[cache.loop];
+			break;
+		}
+		case checkVariableOpcode:
+			if (environment.lookup(instruction.operand).kind != Binding::numberBinding)
+			{
+				state = InterpreterErrorFlags::undefinedVariableFlag;
+				undefinedObject = program.names[instruction.operand];
+			}
+			break;
+		case lessCounterOpcode:
+		{
+			bool result = environment.lookup(instruction.operand).number < stack[stackSize - 1];
+			stack[stackSize - 1] = program.constants[result ? 1 : 0];
+			break;
+		}
+		case stepCounterOpcode:
+		{
+			const Number& step = stack[--stackSize];
+			Number* counter = environment.localNumber(instruction.operand);
+			if (counter)
+			{
+				*counter += step;
+				break;
+			}
+
+			const Binding& binding = environment.lookup(instruction.operand);
+			if (binding.kind != Binding::numberBinding)
+			{
+				state = InterpreterErrorFlags::undefinedVariableFlag;
+				undefinedObject = program.names[instruction.operand];
+				break;
+			}
+			environment.defineNumber(instruction.operand, binding.number + step);
+			break;
+		}
+		case storeArgumentOpcode:
+			environment.inlineArguments[instruction.operand] = std::move(stack[--stackSize]);
+			break;
+		case loadArgumentOpcode:
+			push() = environment.inlineArguments[instruction.operand];
+			break;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Bytecode.h"
+#include "Environment.h"
+#include "JitCompiler.h"
+
+/// Stack machine running a BytecodeProgram. Calls keep their frames on an explicit
+/// stack, so the depth of recursion in the program does not grow the C++ stack.
+///
+/// Functions that run often are handed to JitCompiler once their calls and loop
+/// iterations reach the threshold; the machine then runs their machine code and
+/// only executes the instructions the code leaves to it.
+class VirtualMachine
+{
+private:
+	struct CallFrame
+	{
+		/// Where the caller continues
+		int function;
+		size_t returnAddress;
+		/// Slot of the called name, for error messages
+		int name;
+		/// Memo table the result is stored in with the argument, -1 for none
+		int memoTable;
+		Number argument;
+	};
+
+	std::vector<Number> stack;
+	size_t stackSize;
+	/// stack.data(), read by the machine code; only push moves the entries
+	Number* stackEntries;
+	std::vector<CallFrame> frames;
+
+	/// What run was given, for the helpers of the machine code
+	struct RunContext
+	{
+		const BytecodeProgram* program;
+		Environment* environment;
+		char* state;
+		std::string* undefinedObject;
+		std::ostream* os;
+	};
+
+	RunContext context;
+	/// 0 when the machine only interprets
+	unsigned int jitThreshold;
+	std::vector<unsigned int> hotness;
+	std::vector<JitCode> compiled;
+
+	Number& push();
+	/// Counts a call or a loop iteration of the function, compiles it once the count
+	/// reaches jitThreshold and continues in its machine code from pc
+	void tierUp(int function, size_t& pc);
+	/// Continues in the machine code of the function from pc if it has some, without counting
+	void resumeCompiled(int function, size_t& pc);
+
+public:
+	/// jitThreshold is the number of calls and loop iterations of a function after
+	/// which it is compiled to machine code, 0 turns the compiler off
+	VirtualMachine(unsigned int jitThreshold = 0);
+
+	void run(const BytecodeProgram&, Environment&, char& state, std::string& undefinedObject, std::ostream& os, std::istream& is);
+
+	friend class JitCompiler;
+};
\ No newline at end of file
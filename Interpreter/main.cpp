@@ -1,17 +1,38 @@
 #include "Number.h"
 #include "Interpreter.h"
 
+#include <cstdlib>
+
 using namespace std;
 
-int main()
+int main(int argc, char** argv)
 {
 	Interpreter IT;
 	string address;
+	bool memoStatistics = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!string("--bytecode").compare(argv[i])) IT.setExecutionEngine(bytecodeEngine);
+		else if (!string("--tree-walker").compare(argv[i])) IT.setExecutionEngine(treeWalkingEngine);
+		else if (!string("--max-depth").compare(argv[i]) && i + 1 < argc) IT.setRecursionLimit(strtoul(argv[++i], nullptr, 10));
+		else if (!string("--no-jit").compare(argv[i])) IT.setJitThreshold(0);
+		else if (!string("--jit-threshold").compare(argv[i]) && i + 1 < argc) IT.setJitThreshold(strtoul(argv[++i], nullptr, 10));
+		else if (!string("--no-optimize").compare(argv[i])) IT.setOptimization(false);
+		else if (!string("--no-memo").compare(argv[i])) IT.setMemoization(false);
+		else if (!string("--memo-stats").compare(argv[i])) memoStatistics = true;
+	}
 
 	cout << "Enter program address: ";
 	getline(cin, address);
 
 	IT.run(address);
 
+	if (memoStatistics)
+	{
+		MemoCache::Statistics statistics = IT.memoizationStatistics();
+		cerr << "memo hits: " << statistics.hits << ", misses: " << statistics.misses << ", entries: " << statistics.entries << '\n';
+	}
+
 	return 0;
 }
\ No newline at end of file